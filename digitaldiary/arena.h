@@ -0,0 +1,46 @@
+#pragma once
+
+#include "common.h"
+
+// --------------------- String Arena ----------------------
+// Append-only pool for record text. Strings are packed back to back
+// into large blocks, so a store with a million records costs a few
+// hundred allocations instead of millions. Blocks never move, so the
+// views handed out stay valid until clear().
+class StringArena {
+public:
+    string_view keep(string_view s) {
+        if (s.empty()) return string_view();
+        char* dst;
+        if (s.size() > BLOCK_SIZE / 2) {
+            // oversized string gets its own block, current block stays open
+            large.push_back(unique_ptr<char[]>(new char[s.size()]));
+            dst = large.back().get();
+        } else {
+            if (used + s.size() > cap) {
+                blocks.push_back(unique_ptr<char[]>(new char[BLOCK_SIZE]));
+                used = 0;
+                cap = BLOCK_SIZE;
+            }
+            dst = blocks.back().get() + used;
+            used += s.size();
+        }
+        memcpy(dst, s.data(), s.size());
+        bytes += s.size();
+        return string_view(dst, s.size());
+    }
+    void clear() { blocks.clear(); large.clear(); used = cap = bytes = 0; }
+    // take over another arena's memory; views into it stay valid
+    void absorb(StringArena& o) {
+        for (auto& b : o.blocks) large.push_back(move(b));
+        for (auto& b : o.large) large.push_back(move(b));
+        bytes += o.bytes;
+        o.clear();
+    }
+    size_t bytesUsed() const { return bytes; }
+private:
+    static const size_t BLOCK_SIZE = 256 * 1024;
+    vector<unique_ptr<char[]>> blocks;
+    vector<unique_ptr<char[]>> large;
+    size_t used = 0, cap = 0, bytes = 0;
+};
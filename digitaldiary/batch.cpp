@@ -0,0 +1,419 @@
+#include "batch.h"
+#include "server.h"
+#include "snapshot.h"
+#include "stores.h"
+#include "terminal.h"
+#include "transfer.h"
+#include "users.h"
+
+// -------------------- Batch Mode ------------------------
+// diary --user NAME --batch [FILE]   (FILE "-" or omitted: stdin)
+// One command per line; blank lines and lines starting with '#' are
+// skipped. N is a position as shown by "view" (1 = first), or @ID for
+// the record with that id; ids never change and "ids" lists them.
+//   note add TEXT         ("\n" in TEXT starts a new line, "\\" is a backslash)
+//   note view | note search QUERY | note del N | note clear
+//   task add TEXT | task view | task toggle N | task del N
+//   task clear done       (deletes the completed tasks)
+//   contact add NAME | PHONE
+//   contact view | contact find PREFIX | contact del N | contact clear
+//   note|task|contact ids
+//   note|task|contact between dd/mm/yyyy dd/mm/yyyy
+//   note|task|contact clear before dd/mm/yyyy
+//   note|task|contact import FILE | export FILE   (see Import / Export)
+// Output is plain tab-separated rows, errors go to stderr. Appends are
+// held in memory and each store's log is written once at the end.
+
+// note content from a batch line: "\n" escapes become line breaks
+static bool batchNoteContent(string_view text, string& out) {
+    out.clear();
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '\\' && i + 1 < text.size() && (text[i + 1] == 'n' || text[i + 1] == '\\')) {
+            out += text[++i] == 'n' ? '\n' : '\\';
+        } else {
+            out += text[i];
+        }
+    }
+    out += '\n';
+    // a line holding only "~" would end the note block in notes.txt
+    size_t pos = 0;
+    while (pos < out.size()) {
+        size_t next = out.find('\n', pos);
+        if (next - pos == 1 && out[pos] == '~') return false;
+        pos = next + 1;
+    }
+    return true;
+}
+
+// append s with line breaks and backslashes escaped
+void batchEscape(string& out, string_view s) {
+    for (char ch : s) {
+        if (ch == '\n') out += "\\n";
+        else if (ch == '\\') out += "\\\\";
+        else out += ch;
+    }
+}
+
+static void batchNoteRow(string& out, size_t i) {
+    out += to_string(i + 1);
+    out += '\t';
+    out += notes.dateOf(notes[i]);
+    out += '\t';
+    string_view c = noteText(notes[i]);
+    if (!c.empty() && c.back() == '\n') c.remove_suffix(1);
+    batchEscape(out, c);
+    out += '\n';
+}
+
+static void batchTaskRow(string& out, size_t i) {
+    out += to_string(i + 1);
+    out += tasks.isDone(i) ? "\t[x]\t" : "\t[ ]\t";
+    out += tasks[i].text;
+    out += '\t';
+    out += tasks.dateOf(tasks[i]);
+    out += '\n';
+}
+
+// task row with its due date and priority (0-3)
+static void batchDueRow(string& out, size_t i) {
+    out += to_string(i + 1);
+    out += tasks.isDone(i) ? "\t[x]\t" : "\t[ ]\t";
+    out += tasks[i].text;
+    out += '\t';
+    if (tasks[i].due) out += formatDateTime(taskDue(tasks[i]));
+    out += "\tp";
+    out += char('0' + tasks[i].priority);
+    out += '\n';
+}
+
+static void batchContactRow(string& out, size_t i) {
+    out += to_string(i + 1);
+    out += '\t';
+    out += contacts[i].name;
+    out += '\t';
+    out += contacts[i].phone;
+    out += '\t';
+    out += contacts.dateOf(contacts[i]);
+    out += '\n';
+}
+
+// next space-separated word of rest
+static string_view batchWord(string_view& rest) {
+    size_t b = rest.find_first_not_of(' ');
+    if (b == string_view::npos) { rest = string_view(); return string_view(); }
+    rest.remove_prefix(b);
+    size_t e = rest.find(' ');
+    string_view w = rest.substr(0, e);
+    rest = e == string_view::npos ? string_view() : rest.substr(e + 1);
+    return w;
+}
+
+// 1-based position or @ID argument; SIZE_MAX unless it names a record
+template <typename T>
+static size_t batchPosition(string_view arg, const RecordStore<T>& s) {
+    bool byId = !arg.empty() && arg[0] == '@';
+    if (byId) arg.remove_prefix(1);
+    size_t k = 0;
+    if (arg.empty() || arg.size() > 18) return SIZE_MAX;
+    for (char ch : arg) {
+        if (ch < '0' || ch > '9') return SIZE_MAX;
+        k = k * 10 + (ch - '0');
+    }
+    if (byId) return s.indexOfSeq(k);
+    return (k >= 1 && k <= s.size()) ? k - 1 : SIZE_MAX;
+}
+
+// position and id of every record
+template <typename T>
+static void batchIds(const RecordStore<T>& s, string& out) {
+    for (size_t i = 0; i < s.size(); ++i) {
+        out += to_string(i + 1);
+        out += "\t@";
+        out += to_string(s[i].seq);
+        out += '\n';
+    }
+}
+
+// "due N dd/mm/yyyy [hh:mm]" / "due N -" and "priority N 0-3"
+static bool batchSchedule(string_view verb, string_view rest) {
+    size_t at = batchPosition(batchWord(rest), tasks);
+    if (at == SIZE_MAX) return false;
+    int64_t due = taskDue(tasks[at]);
+    uint8_t priority = tasks[at].priority;
+    if (verb == "due" && !parseDue(rest, due)) return false;
+    if (verb == "priority") {
+        if (rest.size() != 1 || rest[0] < '0' || rest[0] > '3') return false;
+        priority = uint8_t(rest[0] - '0');
+    }
+    return scheduleTask(at, due, priority);
+}
+
+// "next [K]" / "overdue": open tasks with a due date, soonest first
+static bool batchDue(string_view verb, string_view rest, string& out) {
+    size_t k = SIZE_MAX;
+    if (verb == "next" && !rest.empty()) {
+        k = 0;
+        if (rest.size() > 9) return false;
+        for (char ch : rest) {
+            if (ch < '0' || ch > '9') return false;
+            k = k * 10 + (ch - '0');
+        }
+    } else if (!rest.empty()) {
+        return false;
+    }
+    vector<uint32_t> seqs;
+    taskSchedule.next(k, verb == "overdue" ? (int64_t)time(0) : NO_TIME, seqs);
+    for (uint32_t seq : seqs) batchDueRow(out, tasks.indexOfSeq(seq));
+    return true;
+}
+
+// "clear done" (tasks only) / "clear before dd/mm/yyyy"
+static bool batchClear(string_view rest, size_t (*before)(int64_t), size_t (*doneOnes)(), const char* what,
+                       string& out) {
+    string_view how = batchWord(rest);
+    int64_t first, last;
+    size_t n;
+    if (how == "done" && doneOnes && rest.empty()) n = doneOnes();
+    else if (how == "before" && parseDay(batchWord(rest), first, last) && rest.empty()) n = before(first);
+    else return false;
+    out += "deleted " + to_string(n) + what;
+    return true;
+}
+
+// rows for the records of s created between two dd/mm/yyyy days
+template <typename T>
+static bool batchBetween(RecordStore<T>& s, string_view rest, string& out, void (*row)(string&, size_t)) {
+    int64_t from, fromEnd, toStart, to;
+    string_view a = batchWord(rest), b = batchWord(rest);
+    if (!parseDay(a, from, fromEnd) || !parseDay(b, toStart, to)) return false;
+    if (to < from) { from = toStart; to = fromEnd; }
+    vector<size_t> hits;
+    s.range(from, to, hits);
+    for (size_t seq : hits) {
+        size_t at = s.indexOfSeq(seq);
+        if (at != SIZE_MAX) row(out, at);
+    }
+    return true;
+}
+
+// load a store on first use and start holding its appends
+template <typename T>
+static void batchUse(RecordStore<T>& s, void (*wait)()) {
+    if (s.log.holding) return;
+    wait();
+    logWait(s.log);
+    logHold(s.log);
+}
+
+// "import FILE" / "export FILE" for one store; imports store each
+// chunk through apply (see ImportApply)
+static bool batchTransfer(string_view verb, string_view file, char kind, string& out, size_t& errors,
+                          const ImportApply& apply = {}) {
+    string path(file);
+    bool csv = isCsvPath(path);
+    if (path.empty() || (csv && kind == 'n')) return false;
+    if (verb == "export") {
+        if (path == "-") { writeOut(out); out.clear(); } // keep stdout in order
+        ExportWriter w;
+        if (!w.open(path)) return false;
+        if (kind == 'n') exportRecords(w, notes, false);
+        else if (kind == 't') exportRecords(w, tasks, csv);
+        else exportRecords(w, contacts, csv);
+        return w.close();
+    }
+    ifstream in(path, ios::binary);
+    if (!in) return false;
+    STAT_IO(fileOpens, 1);
+    size_t n = kind == 'n' ? importNotes(in, path, errors, apply)
+             : kind == 't' ? importTasks(in, path, csv, errors, apply)
+             : importContacts(in, path, csv, errors, apply);
+    out += "imported " + to_string(n) + (kind == 'n' ? " notes\n" : kind == 't' ? " tasks\n" : " contacts\n");
+    return true;
+}
+
+// "undo" / "redo": take back (or make again) the last change to s
+template <typename T>
+static bool batchUndo(RecordStore<T>& s, string_view verb, string_view rest, string& out) {
+    string label;
+    if (!rest.empty() || !stepUndo(s, verb == "redo", label)) return false;
+    out += (verb == "redo" ? "redid " : "undid ") + label + "\n";
+    return true;
+}
+
+// write what a store held, compacting instead when the log is due for it
+template <typename T>
+static void batchCommit(RecordStore<T>& s, void (*rewrite)()) {
+    if (!s.log.holding) return;
+    if (needsCompaction(s)) rewrite();
+    logCommit(s.log);
+}
+
+// Run one batch command, appending its rows to out. Local runs load a
+// store on first use and hold its appends; a server has loaded the
+// stores and commits for itself, and cannot import from or export to
+// its own stdin / stdout.
+bool batchRun(string_view line, string& out, size_t& errors, bool local) {
+    string content;
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    string_view rest = line;
+    string_view store = batchWord(rest);
+    if (store.empty() || store[0] == '#') return true;
+    string_view verb = batchWord(rest);
+    if (!local && (verb == "import" || verb == "export") && rest == "-") return false;
+    bool ok = true;
+    if (store == "note") {
+        if (local) batchUse(notes, waitNotes);
+        if (verb == "add" && batchNoteContent(rest, content)) insertNote(content);
+        else if (verb == "view") for (size_t i = 0; i < notes.size(); ++i) batchNoteRow(out, i);
+        else if (verb == "search") {
+            for (size_t seq : noteIndex.search(string(rest), SIZE_MAX)) {
+                size_t at = notes.indexOfSeq(seq);
+                if (at != SIZE_MAX) batchNoteRow(out, at);
+            }
+        }
+        else if (verb == "del") {
+            size_t at = batchPosition(rest, notes);
+            if ((ok = at != SIZE_MAX)) removeNote(at);
+        }
+        else if (verb == "clear" && rest.empty()) removeAllNotes();
+        else if (verb == "clear") ok = batchClear(rest, removeNotesBefore, nullptr, " notes\n", out);
+        else if (verb == "ids" && rest.empty()) batchIds(notes, out);
+        else if (verb == "between") ok = batchBetween(notes, rest, out, batchNoteRow);
+        else if (verb == "import" || verb == "export") ok = batchTransfer(verb, rest, 'n', out, errors);
+        else if (verb == "undo" || verb == "redo") ok = batchUndo(notes, verb, rest, out);
+        else ok = false;
+        recordUndo(notes, line);
+    } else if (store == "task") {
+        if (local) batchUse(tasks, waitTasks);
+        if (verb == "add") insertTask(rest);
+        else if (verb == "view") for (size_t i = 0; i < tasks.size(); ++i) batchTaskRow(out, i);
+        else if (verb == "toggle" || verb == "del") {
+            size_t at = batchPosition(rest, tasks);
+            if ((ok = at != SIZE_MAX)) { if (verb == "del") removeTask(at); else toggleTask(at); }
+        }
+        else if (verb == "clear") ok = batchClear(rest, removeTasksBefore, removeDoneTasks, " tasks\n", out);
+        else if (verb == "due" || verb == "priority") ok = batchSchedule(verb, rest);
+        else if (verb == "next" || verb == "overdue") ok = batchDue(verb, rest, out);
+        else if (verb == "ids" && rest.empty()) batchIds(tasks, out);
+        else if (verb == "between") ok = batchBetween(tasks, rest, out, batchTaskRow);
+        else if (verb == "import" || verb == "export") ok = batchTransfer(verb, rest, 't', out, errors);
+        else if (verb == "undo" || verb == "redo") ok = batchUndo(tasks, verb, rest, out);
+        else ok = false;
+        recordUndo(tasks, line);
+    } else if (store == "contact") {
+        if (local) batchUse(contacts, waitContacts);
+        if (verb == "add") {
+            size_t bar = rest.rfind('|');
+            string_view name = rest.substr(0, bar), phone;
+            if (bar != string_view::npos) phone = rest.substr(bar + 1);
+            while (!name.empty() && name.back() == ' ') name.remove_suffix(1);
+            while (!phone.empty() && phone.front() == ' ') phone.remove_prefix(1);
+            if ((ok = !name.empty())) insertContact(name, phone);
+        }
+        else if (verb == "view") for (size_t i = 0; i < contacts.size(); ++i) batchContactRow(out, i);
+        else if (verb == "find") {
+            string q(rest);
+            bool byName = false;
+            for (char ch : q) if (isalpha((unsigned char)ch)) byName = true;
+            string key = byName ? nameKey(q) : phoneKey(q);
+            vector<uint32_t> hits;
+            if ((ok = !key.empty())) (byName ? contactIndex.byName : contactIndex.byPhone).find(key, SIZE_MAX, hits);
+            for (uint32_t seq : hits) {
+                size_t at = contacts.indexOfSeq(seq);
+                if (at != SIZE_MAX) batchContactRow(out, at);
+            }
+        }
+        else if (verb == "del") {
+            size_t at = batchPosition(rest, contacts);
+            if ((ok = at != SIZE_MAX)) removeContact(at);
+        }
+        else if (verb == "clear" && rest.empty()) removeAllContacts();
+        else if (verb == "clear") ok = batchClear(rest, removeContactsBefore, nullptr, " contacts\n", out);
+        else if (verb == "ids" && rest.empty()) batchIds(contacts, out);
+        else if (verb == "between") ok = batchBetween(contacts, rest, out, batchContactRow);
+        else if (verb == "import" || verb == "export") ok = batchTransfer(verb, rest, 'c', out, errors);
+        else if (verb == "undo" || verb == "redo") ok = batchUndo(contacts, verb, rest, out);
+        else ok = false;
+        recordUndo(contacts, line);
+    } else {
+        ok = false;
+    }
+    return ok;
+}
+
+// "note|task|contact import FILE"
+bool batchIsImport(string_view line) {
+    string_view rest = line;
+    string_view store = batchWord(rest);
+    return (store == "note" || store == "task" || store == "contact") && batchWord(rest) == "import";
+}
+
+// A daemon's import: read and parse here, store each chunk through
+// apply as one undo step, so other writes can come in between
+bool batchImport(string_view line, string& out, size_t& errors, const ImportApply& apply) {
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    string_view rest = line;
+    char kind = batchWord(rest)[0];
+    batchWord(rest);
+    if (rest == "-") return false;
+    return batchTransfer("import", rest, kind, out, errors, [&](const function<void()>& store) {
+        apply([&]() {
+            store();
+            if (kind == 'n') recordUndo(notes, line);
+            else if (kind == 't') recordUndo(tasks, line);
+            else recordUndo(contacts, line);
+        });
+    });
+}
+
+// true for commands that change a store
+bool batchIsWrite(string_view line) {
+    string_view rest = line;
+    batchWord(rest);
+    string_view verb = batchWord(rest);
+    return verb == "add" || verb == "del" || verb == "toggle" || verb == "clear" || verb == "import"
+        || verb == "due" || verb == "priority" || verb == "undo" || verb == "redo";
+}
+
+int runBatch(const string& user, const string& path, const string& keyFile) {
+    if (!authenticate(user, keyFile)) return 1;
+    ifstream file;
+    if (path != "-") {
+        file.open(path, ios::binary);
+        if (!file) { cerr << "Cannot open " << path << "\n"; return 1; }
+        STAT_IO(fileOpens, 1);
+    }
+    istream& in = (path == "-") ? cin : file;
+    ios::sync_with_stdio(false);
+    openUserShard(user);
+#ifndef _WIN32
+    // a daemon owns the shard: the commands go through it
+    if (!lockShard(false)) return remoteBatch(in, SERVER_SOCKET);
+#else
+    lockShard(false);
+#endif
+
+    string line, out;
+    size_t lineNo = 0, errors = 0;
+    while (getline(in, line)) {
+        ++lineNo;
+        if (!batchRun(line, out, errors, true)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            cerr << "line " << lineNo << ": cannot run: " << line << "\n";
+            ++errors;
+        }
+        if (out.size() >= (1 << 20)) { writeOut(out); out.clear(); }
+    }
+    writeOut(out);
+
+    // one write per store, then the usual exit work
+    batchCommit(notes, rewriteNotesFile);
+    batchCommit(tasks, rewriteTasksFile);
+    batchCommit(contacts, rewriteContactsFile);
+    closeLogs();
+    saveSnapshots();
+    saveUndoHistories();
+    saveNoteIndex();
+    dumpStats();
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "transfer.h"
+
+// -------------------- Batch Mode ------------------------
+// Run commands from path ("-" for stdin) for one user, no prompts or
+// colors once the key checks out (see authenticate)
+int runBatch(const string& user, const string& path, const string& keyFile);
+// Run one command, appending its rows to out (local: load stores and
+// hold appends as runBatch does; otherwise the daemon does both)
+bool batchRun(string_view line, string& out, size_t& errors, bool local);
+// true for commands that change a store
+bool batchIsWrite(string_view line);
+// true for "import FILE" commands, which a daemon runs with batchImport:
+// the file is parsed outside its write lock, then stored in chunks that
+// each go through apply
+bool batchIsImport(string_view line);
+bool batchImport(string_view line, string& out, size_t& errors, const ImportApply& apply);
+// Append s with line breaks and backslashes escaped
+void batchEscape(string& out, string_view s);
@@ -0,0 +1,341 @@
+#include "bench.h"
+#include "crypto.h"
+#include "snapshot.h"
+#include "stores.h"
+#include "terminal.h"
+#include "ui.h"
+#include "users.h"
+
+// ---------------------- Benchmark ------------------------
+// Built only with -DDIARY_BENCH (POSIX): the diary_bench target, e.g.
+//   cmake --build build --target diary_bench
+//   build/diary_bench --bench [--counts 1000,100000,10000000] [--ops N]
+//                 [--note-bytes N] [--seed N] [--dir PATH] [--keep]
+// For each record count a child process generates notes, tasks and
+// contacts with a seeded generator, then times the store operations.
+// Every result is one JSON line on stdout:
+//   {"records": N, "op": "...", "samples": S, "ops_per_sec": X,
+//    "p50_us": X, "p99_us": X, "peak_rss_kb": K}
+// Loads and rewrites are single samples and their ops_per_sec counts
+// records per second. peak_rss_kb is the child's peak so far.
+#ifdef DIARY_BENCH
+
+struct BenchConfig {
+    vector<size_t> counts = {1000, 100000, 10000000};
+    size_t ops = 1000;          // samples per timed operation
+    size_t noteBytes = 200;     // approximate note content size
+    uint64_t seed = 1;
+    string dir = "bench_data";
+    bool keep = false;          // leave the generated files behind
+    double budget = 2.0;        // seconds per operation before sampling stops
+};
+
+// deterministic generator (splitmix64)
+struct BenchRng {
+    uint64_t s;
+    uint64_t next() {
+        uint64_t z = (s += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+    size_t below(size_t n) { return n ? (size_t)(next() % n) : 0; }
+};
+
+static const char* const BENCH_WORDS[] = {
+    "meeting", "project", "groceries", "call", "doctor", "birthday", "report", "travel",
+    "weekend", "gym", "book", "coffee", "deadline", "review", "garden", "school",
+    "invoice", "holiday", "dinner", "plan", "idea", "music", "family", "budget"};
+static const char* const BENCH_NAMES[] = {
+    "Ali", "Sara", "John", "Maria", "Chen", "Fatima", "Omar", "Lena", "Ravi", "Aisha",
+    "Tom", "Yuki", "Ivan", "Nora", "Pablo", "Zara"};
+
+static void benchWords(BenchRng& rng, string& out, size_t bytes) {
+    size_t start = out.size();
+    while (out.size() - start < bytes) {
+        out += BENCH_WORDS[rng.below(sizeof(BENCH_WORDS) / sizeof(*BENCH_WORDS))];
+        out += (rng.below(12) == 0) ? '\n' : ' ';
+    }
+    out += '\n';
+}
+
+// Write count notes, tasks and contacts as text logs into the current shard
+static void benchGenerate(const BenchConfig& cfg, size_t count) {
+    BenchRng rng{cfg.seed};
+    const int64_t base = 1577836800; // 01/01/2020 UTC, one record per minute
+    string text, phone, out;
+    FILE* nf = fopen(NOTES_FILE.c_str(), "wb");
+    FILE* tf = fopen(TASKS_FILE.c_str(), "wb");
+    FILE* cf = fopen(CONTACTS_FILE.c_str(), "wb");
+    if (!nf || !tf || !cf) {
+        cerr << "bench: cannot create files in " << cfg.dir << "\n";
+        exit(1);
+    }
+    auto flushTo = [&](FILE* f) { fwrite(out.data(), 1, out.size(), f); out.clear(); };
+    for (size_t i = 0; i < count; ++i) {
+        text.clear();
+        benchWords(rng, text, cfg.noteBytes / 2 + rng.below(cfg.noteBytes + 1));
+        Note n{text, base + (int64_t)i * 60, 0, 0};
+        formatRecord(out, n, false, notes.dateOf(n));
+        if (out.size() >= EXPORT_CHUNK) flushTo(nf);
+    }
+    flushTo(nf);
+    for (size_t i = 0; i < count; ++i) {
+        text.clear();
+        benchWords(rng, text, 20 + rng.below(40));
+        text.pop_back();
+        for (char& ch : text) if (ch == '\n') ch = ' ';
+        Task t{text, base + (int64_t)i * 60, 0, 0};
+        if (i % 4 == 0) { // every 4th task due within two months of creation
+            t.due = uint32_t((base / 60) + i + (i * 7919) % 86400);
+            t.priority = uint8_t(i % 3 + 1);
+        }
+        formatRecord(out, t, rng.below(3) == 0, tasks.dateOf(t));
+        if (out.size() >= EXPORT_CHUNK) flushTo(tf);
+    }
+    flushTo(tf);
+    for (size_t i = 0; i < count; ++i) {
+        text = BENCH_NAMES[rng.below(sizeof(BENCH_NAMES) / sizeof(*BENCH_NAMES))];
+        text += ' ';
+        text += BENCH_NAMES[rng.below(sizeof(BENCH_NAMES) / sizeof(*BENCH_NAMES))];
+        text += to_string(i);
+        phone = "+1 555 " + to_string(1000000 + rng.below(9000000));
+        Contact c{text, phone, base + (int64_t)i * 60, 0, 0};
+        formatRecord(out, c, false, contacts.dateOf(c));
+        if (out.size() >= EXPORT_CHUNK) flushTo(cf);
+    }
+    flushTo(cf);
+    fclose(nf);
+    fclose(tf);
+    fclose(cf);
+}
+
+static long benchPeakRssKb() {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss; // kilobytes on Linux
+}
+
+// print one result line; samples are per-op latencies in seconds
+static void benchReport(size_t records, const char* op, vector<double>& samples, double perSample = 1) {
+    if (samples.empty()) return;
+    sort(samples.begin(), samples.end());
+    double total = 0;
+    for (double s : samples) total += s;
+    auto pct = [&](double p) { return samples[min(samples.size() - 1, (size_t)(p * samples.size()))] * 1e6; };
+    printf("{\"records\": %zu, \"op\": \"%s\", \"samples\": %zu, \"ops_per_sec\": %.1f, "
+           "\"p50_us\": %.2f, \"p99_us\": %.2f, \"peak_rss_kb\": %ld}\n",
+           records, op, samples.size(), total > 0 ? samples.size() * perSample / total : 0.0,
+           pct(0.50), pct(0.99), benchPeakRssKb());
+    fflush(stdout);
+}
+
+// time fn(i) up to cfg.ops times, stopping early once the budget is spent
+static void benchOps(const BenchConfig& cfg, size_t records, const char* op, const function<void(size_t)>& fn) {
+    vector<double> samples;
+    samples.reserve(cfg.ops);
+    double spent = 0;
+    for (size_t i = 0; i < cfg.ops && spent < cfg.budget; ++i) {
+        auto t0 = chrono::steady_clock::now();
+        fn(i);
+        double s = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        samples.push_back(s);
+        spent += s;
+    }
+    benchReport(records, op, samples);
+}
+
+// time one call that handles `records` records
+static void benchOnce(size_t records, const char* op, const function<void()>& fn) {
+    auto t0 = chrono::steady_clock::now();
+    fn();
+    vector<double> one(1, chrono::duration<double>(chrono::steady_clock::now() - t0).count());
+    benchReport(records, op, one, (double)max<size_t>(records, 1));
+}
+
+// all measurements for one record count (runs in a child process)
+static void benchSize(const BenchConfig& cfg, size_t count) {
+    string dir = cfg.dir + "/n" + to_string(count) + "/";
+    error_code ec;
+    filesystem::remove_all(dir, ec);
+    openShardDir(dir);
+    benchGenerate(cfg, count);
+    BenchRng rng{cfg.seed ^ count};
+    string out;
+
+    benchOnce(count, "load_notes", loadNotes);
+    benchOnce(count, "load_tasks", loadTasks);
+    benchOnce(count, "load_contacts", loadContacts);
+    saveSnapshots();
+    saveNoteIndex();
+    benchOnce(count, "load_notes_snapshot", loadNotes);
+    benchOnce(count, "load_tasks_snapshot", loadTasks);
+    benchOnce(count, "load_contacts_snapshot", loadContacts);
+
+    // one page of each list view, formatted into a buffer
+    auto page = [&](size_t n, void (*row)(string&, size_t)) {
+        out.clear();
+        size_t from = rng.below(n > pageSize ? n - pageSize : 1);
+        for (size_t i = from; i < min(n, from + pageSize); ++i) row(out, i);
+    };
+    benchOps(cfg, count, "view_notes_page", [&](size_t) { page(notes.size(), formatNoteBlock); });
+    benchOps(cfg, count, "view_tasks_page", [&](size_t) { page(tasks.size(), formatTaskRow); });
+    benchOps(cfg, count, "view_contacts_page", [&](size_t) { page(contacts.size(), formatContactRow); });
+    // task pages drawn on a terminal-sized Screen, writing only the changes
+    Screen screen;
+    screen.resize(40, 120);
+    string frame;
+    benchOps(cfg, count, "redraw_tasks_page", [&](size_t) {
+        page(tasks.size(), formatTaskRow);
+        frame = screen.draw(out, "[n]ext [p]rev [j]ump N [s]ize N [q]uit: ");
+    });
+    size_t doneCount = 0;
+    benchOps(cfg, count, "count_done_tasks", [&](size_t) { doneCount += tasks.doneCount(); });
+    printf("{\"records\": %zu, \"op\": \"record_bytes\", \"note\": %zu, \"task\": %zu, \"contact\": %zu, \"done_tasks\": %zu}\n",
+           count, sizeof(Note), sizeof(Task), sizeof(Contact), tasks.doneCount());
+
+    // the same notes with packed content: snapshot sizes, load time and
+    // page views (the first view in a block inflates it), then back to plain
+    int64_t plainBytes = fileSize(NOTES_SNAPSHOT);
+    notePacking = NotePacking::On;
+    saveSnapshot(notes, NOTES_FILE, NOTES_SNAPSHOT);
+    int64_t packedBytes = fileSize(NOTES_SNAPSHOT);
+    printf("{\"records\": %zu, \"op\": \"pack_notes\", \"plain_bytes\": %lld, \"packed_bytes\": %lld, \"ratio\": %.2f}\n",
+           count, (long long)plainBytes, (long long)packedBytes, packedBytes > 0 ? (double)plainBytes / packedBytes : 0.0);
+    benchOnce(count, "load_notes_packed", loadNotes);
+    benchOps(cfg, count, "view_notes_page_packed", [&](size_t) { page(notes.size(), formatNoteBlock); });
+    notePacking = NotePacking::Off;
+    saveSnapshot(notes, NOTES_FILE, NOTES_SNAPSHOT);
+    notePacking = NotePacking::Keep;
+    loadNotes();
+
+    // each change closes an undo step, as the menus do
+    string content;
+    benchOps(cfg, count, "append_note", [&](size_t) {
+        content.clear();
+        benchWords(rng, content, cfg.noteBytes);
+        insertNote(content);
+        recordUndo(notes, "Add Note");
+    });
+    benchOps(cfg, count, "append_task", [&](size_t i) { insertTask("bench task " + to_string(i)); recordUndo(tasks, "Add Task"); });
+    benchOps(cfg, count, "append_contact", [&](size_t i) {
+        insertContact("Bench " + to_string(i), "555 0100");
+        recordUndo(contacts, "Add Contact");
+    });
+    benchOps(cfg, count, "toggle_task", [&](size_t) { toggleTask(rng.below(tasks.size())); recordUndo(tasks, "Toggle Task"); });
+    vector<uint32_t> upcoming;
+    benchOps(cfg, count, "next_due_tasks", [&](size_t) { upcoming.clear(); taskSchedule.next(10, NO_TIME, upcoming); });
+    benchOps(cfg, count, "reschedule_task", [&](size_t) {
+        size_t i = rng.below(tasks.size());
+        scheduleTask(i, tasks[i].created + (int64_t)rng.below(86400) * 60, uint8_t(rng.below(4)));
+        recordUndo(tasks, "Set Due Date / Priority");
+    });
+    benchOps(cfg, count, "delete_note", [&](size_t) {
+        if (!notes.empty()) removeNote(rng.below(notes.size()));
+        recordUndo(notes, "Delete Note");
+    });
+    benchOps(cfg, count, "delete_task", [&](size_t) {
+        if (!tasks.empty()) removeTask(rng.below(tasks.size()));
+        recordUndo(tasks, "Delete Task");
+    });
+    benchOps(cfg, count, "delete_contact", [&](size_t) {
+        if (!contacts.empty()) removeContact(rng.below(contacts.size()));
+        recordUndo(contacts, "Delete Contact");
+    });
+    string label;
+    benchOps(cfg, count, "delete_undo_task", [&](size_t) {
+        if (!tasks.empty()) removeTask(rng.below(tasks.size()));
+        recordUndo(tasks, "Delete Task");
+        stepUndo(tasks, false, label);
+    });
+    benchOnce(tasks.size(), "clear_done_tasks", []() { removeDoneTasks(); recordUndo(tasks, "Delete Completed Tasks"); });
+    benchOnce(tasks.size(), "undo_clear_done_tasks", [&]() { stepUndo(tasks, false, label); });
+    benchOnce(tasks.size(), "redo_clear_done_tasks", [&]() { stepUndo(tasks, true, label); });
+
+    logWait(notes.log); logWait(tasks.log); logWait(contacts.log);
+    benchOnce(notes.size(), "rewrite_notes", []() { rewriteNotesFile(); logWait(notes.log); });
+    benchOnce(tasks.size(), "rewrite_tasks", []() { rewriteTasksFile(); logWait(tasks.log); });
+    benchOnce(contacts.size(), "rewrite_contacts", []() { rewriteContactsFile(); logWait(contacts.log); });
+    // what the menu waits for: the rest runs on the persistence worker
+    benchOnce(notes.size(), "compact_notes_request", rewriteNotesFile);
+    benchOnce(tasks.size(), "compact_tasks_request", rewriteTasksFile);
+    benchOnce(contacts.size(), "compact_contacts_request", rewriteContactsFile);
+    closeLogs();
+
+    // user registry: up to a million users stored with a cheap key, then
+    // one key check at the configured --key-iterations
+    size_t userCount = min<size_t>(count, 1000000);
+    string credential = hashKey("bench", 1);
+    {
+        FILE* uf = fopen((dir + "users.txt").c_str(), "wb");
+        if (!uf) { cerr << "bench: cannot create files in " << cfg.dir << "\n"; exit(1); }
+        out.clear();
+        for (size_t i = 0; i < userCount; ++i) {
+            out += "user" + to_string(i) + " " + credential + "\n";
+            if (out.size() >= EXPORT_CHUNK) { fwrite(out.data(), 1, out.size(), uf); out.clear(); }
+        }
+        fwrite(out.data(), 1, out.size(), uf);
+        fclose(uf);
+    }
+    UserRegistry registry(dir + "users.txt", dir + "users.idx");
+    benchOnce(userCount, "users_index_rebuild", [&]() { registry.rebuild(); });
+    benchOps(cfg, userCount, "user_lookup", [&](size_t) { registry.find("user" + to_string(rng.below(userCount)), content); });
+    benchOps(cfg, userCount, "user_add", [&](size_t i) { registry.add("new" + to_string(i), credential); });
+    string stored = hashKey("bench", keyIterations);
+    benchOps(cfg, userCount, "key_verify", [&](size_t) { checkKey(stored, "bench"); });
+
+    if (!cfg.keep) {
+        error_code ec;
+        filesystem::remove_all(dir, ec);
+    }
+}
+
+int runBench(const vector<string>& args) {
+    BenchConfig cfg;
+    for (size_t i = 1; i < args.size(); ++i) {
+        const string& a = args[i];
+        bool hasValue = i + 1 < args.size();
+        if (a == "--keep") { cfg.keep = true; continue; }
+        if (!hasValue) { cerr << "bench: missing value for " << a << "\n"; return 1; }
+        const string& v = args[++i];
+        try {
+            if (a == "--counts") {
+                cfg.counts.clear();
+                size_t pos = 0;
+                while (pos <= v.size()) {
+                    size_t comma = v.find(',', pos);
+                    if (comma == string::npos) comma = v.size();
+                    cfg.counts.push_back(stoull(v.substr(pos, comma - pos)));
+                    pos = comma + 1;
+                }
+            }
+            else if (a == "--ops") cfg.ops = max<size_t>(1, stoull(v));
+            else if (a == "--note-bytes") cfg.noteBytes = max<size_t>(1, stoull(v));
+            else if (a == "--seed") cfg.seed = stoull(v);
+            else if (a == "--dir") cfg.dir = v;
+            else { cerr << "bench: unknown option " << a << "\n"; return 1; }
+        } catch (const exception&) {
+            cerr << "bench: bad value for " << a << "\n";
+            return 1;
+        }
+    }
+    // one child per size, so peak RSS and caches start fresh each time
+    for (size_t count : cfg.counts) {
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid < 0) { cerr << "bench: fork failed\n"; return 1; }
+        if (pid == 0) {
+            benchSize(cfg, count);
+            fflush(stdout);
+            _exit(0);
+        }
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            cerr << "bench: run with " << count << " records failed\n";
+            return 1;
+        }
+    }
+    return 0;
+}
+#endif
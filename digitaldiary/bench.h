@@ -0,0 +1,9 @@
+#pragma once
+
+#include "common.h"
+
+#ifdef DIARY_BENCH
+// ---------------------- Benchmark ------------------------
+// Generate synthetic diaries and print timings as JSON lines
+int runBench(const vector<string>& args);
+#endif
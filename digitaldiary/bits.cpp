@@ -0,0 +1,242 @@
+#include "bits.h"
+#include "files.h"
+
+// ------------------- Persistent Bit Set ------------------
+bool PersistentBits::test(size_t id) const {
+    if (!root || id >= span(height)) return false;
+    const Ref* n = &root;
+    for (unsigned h = height; h > 0; --h) {
+        n = &inner(*n)->kid[(id / span(h - 1)) % FAN];
+        if (!*n) return false;
+    }
+    return (leaf(*n)->w[(id / 64) % WORDS] >> (id % 64)) & 1;
+}
+
+PersistentBits PersistentBits::lifted(unsigned h) const {
+    PersistentBits p = *this;
+    for (; p.height < h; ++p.height) {
+        if (!p.root) continue;
+        auto up = make_shared<Inner>();
+        up->kid[0] = p.root;
+        p.root = up;
+    }
+    return p;
+}
+
+PersistentBits PersistentBits::with(size_t id, bool on) const {
+    if (test(id) == on) return *this;
+    unsigned h = height;
+    while (id >= span(h)) ++h; // only when adding
+    PersistentBits p = lifted(h);
+    p.root = setIn(p.root, h, id, on);
+    return p;
+}
+
+// copy of the path down to id, null where it leaves a subtree empty
+PersistentBits::Ref PersistentBits::setIn(const Ref& n, unsigned h, uint64_t id, bool on) {
+    if (h == 0) {
+        auto l = n ? make_shared<Leaf>(*leaf(n)) : make_shared<Leaf>();
+        uint64_t& w = l->w[(id / 64) % WORDS];
+        uint64_t m = uint64_t(1) << (id % 64);
+        w = on ? w | m : w & ~m;
+        for (uint64_t x : l->w)
+            if (x) return l;
+        return nullptr;
+    }
+    auto c = n ? make_shared<Inner>(*inner(n)) : make_shared<Inner>();
+    Ref& k = c->kid[(id / span(h - 1)) % FAN];
+    k = setIn(k, h - 1, id, on);
+    for (const Ref& x : c->kid)
+        if (x) return c;
+    return nullptr;
+}
+
+PersistentBits PersistentBits::without(const vector<uint32_t>& sorted) const {
+    const uint32_t* first = sorted.data();
+    const uint32_t* last = first + sorted.size();
+    while (last != first && last[-1] >= span(height)) --last;
+    PersistentBits p = *this;
+    p.root = dropIn(root, height, 0, first, last);
+    return p;
+}
+
+// [first, last) are ascending ids inside this subtree, which starts at base
+PersistentBits::Ref PersistentBits::dropIn(const Ref& n, unsigned h, uint64_t base, const uint32_t* first,
+                                           const uint32_t* last) {
+    if (!n || first == last) return n;
+    if (h == 0) {
+        auto l = make_shared<Leaf>(*leaf(n));
+        for (const uint32_t* p = first; p != last; ++p) {
+            uint64_t off = *p - base;
+            l->w[off / 64] &= ~(uint64_t(1) << (off % 64));
+        }
+        for (uint64_t x : l->w)
+            if (x) return l;
+        return nullptr;
+    }
+    auto c = make_shared<Inner>(*inner(n));
+    uint64_t sub = span(h - 1);
+    for (const uint32_t* p = first; p != last;) {
+        size_t k = (*p - base) / sub;
+        uint64_t end = base + (k + 1) * sub;
+        const uint32_t* q = p;
+        while (q != last && *q < end) ++q;
+        c->kid[k] = dropIn(c->kid[k], h - 1, base + k * sub, p, q);
+        p = q;
+    }
+    for (const Ref& x : c->kid)
+        if (x) return c;
+    return nullptr;
+}
+
+PersistentBits PersistentBits::fromWords(const vector<uint64_t>& words) {
+    PersistentBits p;
+    vector<Ref> level;
+    for (size_t i = 0; i < words.size(); i += WORDS) {
+        shared_ptr<Leaf> l;
+        for (size_t j = 0; j < WORDS && i + j < words.size(); ++j) {
+            if (!words[i + j]) continue;
+            if (!l) l = make_shared<Leaf>();
+            l->w[j] = words[i + j];
+        }
+        level.push_back(l);
+    }
+    for (; level.size() > 1; ++p.height) {
+        vector<Ref> up;
+        for (size_t i = 0; i < level.size(); i += FAN) {
+            shared_ptr<Inner> c;
+            for (size_t k = 0; k < FAN && i + k < level.size(); ++k) {
+                if (!level[i + k]) continue;
+                if (!c) c = make_shared<Inner>();
+                c->kid[k] = level[i + k];
+            }
+            up.push_back(c);
+        }
+        level.swap(up);
+    }
+    if (!level.empty()) p.root = level[0];
+    return p;
+}
+
+void PersistentBits::diff(const PersistentBits& a, const PersistentBits& b, vector<uint32_t>& out) {
+    unsigned h = max(a.height, b.height);
+    diffIn(a.lifted(h).root, b.lifted(h).root, h, 0, out);
+}
+
+void PersistentBits::diffIn(const Ref& a, const Ref& b, unsigned h, uint64_t base, vector<uint32_t>& out) {
+    if (a == b) return;
+    if (h == 0) {
+        for (unsigned i = 0; i < WORDS; ++i) {
+            uint64_t x = (a ? leaf(a)->w[i] : 0) ^ (b ? leaf(b)->w[i] : 0);
+            for (; x; x &= x - 1) out.push_back((uint32_t)(base + i * 64 + bitCount((x & (0 - x)) - 1)));
+        }
+        return;
+    }
+    uint64_t sub = span(h - 1);
+    for (unsigned k = 0; k < FAN; ++k)
+        diffIn(a ? inner(a)->kid[k] : nullptr, b ? inner(b)->kid[k] : nullptr, h - 1, base + k * sub, out);
+}
+
+PersistentBits PersistentBits::unite(const PersistentBits& a, const PersistentBits& b) {
+    unsigned h = max(a.height, b.height);
+    PersistentBits p;
+    p.height = h;
+    p.root = uniteIn(a.lifted(h).root, b.lifted(h).root, h);
+    return p;
+}
+
+// reuses a or b wherever one already holds the union
+PersistentBits::Ref PersistentBits::uniteIn(const Ref& a, const Ref& b, unsigned h) {
+    if (!a || a == b) return b;
+    if (!b) return a;
+    bool isA = true, isB = true;
+    if (h == 0) {
+        auto l = make_shared<Leaf>();
+        for (unsigned i = 0; i < WORDS; ++i) {
+            l->w[i] = leaf(a)->w[i] | leaf(b)->w[i];
+            isA = isA && l->w[i] == leaf(a)->w[i];
+            isB = isB && l->w[i] == leaf(b)->w[i];
+        }
+        return isA ? a : isB ? b : Ref(l);
+    }
+    auto c = make_shared<Inner>();
+    for (unsigned k = 0; k < FAN; ++k) {
+        const Ref& ka = inner(a)->kid[k];
+        const Ref& kb = inner(b)->kid[k];
+        c->kid[k] = uniteIn(ka, kb, h - 1);
+        isA = isA && c->kid[k] == ka;
+        isB = isB && c->kid[k] == kb;
+    }
+    return isA ? a : isB ? b : Ref(c);
+}
+
+// u8 height, then the nodes depth first: u32 0 for an empty subtree,
+// n + 2 for node n of the table, or 1 and a new node (8 u64 words for
+// a leaf, 16 child codes for an inner node), numbered once written
+void PersistentBits::save(string& out, Table& t) const {
+    putRaw<uint8_t>(out, (uint8_t)height);
+    saveIn(root, height, out, t);
+}
+
+void PersistentBits::saveIn(const Ref& n, unsigned h, string& out, Table& t) {
+    if (!n) {
+        putRaw<uint32_t>(out, 0);
+        return;
+    }
+    auto it = t.ids.find(n.get());
+    if (it != t.ids.end()) {
+        putRaw<uint32_t>(out, it->second + 2);
+        return;
+    }
+    putRaw<uint32_t>(out, 1);
+    if (h == 0)
+        for (uint64_t x : leaf(n)->w) putRaw<uint64_t>(out, x);
+    else
+        for (const Ref& k : inner(n)->kid) saveIn(k, h - 1, out, t);
+    t.ids.emplace(n.get(), (uint32_t)t.nodes.size());
+    t.nodes.emplace_back(n, h);
+}
+
+bool PersistentBits::load(string_view& in, Table& t) {
+    if (in.empty()) return false;
+    unsigned h = (uint8_t)in[0];
+    in.remove_prefix(1);
+    Ref r;
+    if (h > MAX_HEIGHT || !loadIn(r, h, in, t)) return false;
+    root = r;
+    height = h;
+    return true;
+}
+
+bool PersistentBits::loadIn(Ref& n, unsigned h, string_view& in, Table& t) {
+    if (in.size() < 4) return false;
+    uint32_t code = getRaw<uint32_t>(in.data());
+    in.remove_prefix(4);
+    n = nullptr;
+    if (code == 0) return true;
+    if (code >= 2) {
+        size_t i = code - 2;
+        if (i >= t.nodes.size() || t.nodes[i].second != h) return false;
+        n = t.nodes[i].first;
+        return true;
+    }
+    bool any = false;
+    if (h == 0) {
+        if (in.size() < sizeof(Leaf::w)) return false;
+        auto l = make_shared<Leaf>();
+        memcpy(l->w, in.data(), sizeof(l->w));
+        in.remove_prefix(sizeof(l->w));
+        for (uint64_t x : l->w) any = any || x;
+        n = l;
+    } else {
+        auto c = make_shared<Inner>();
+        for (Ref& k : c->kid) {
+            if (!loadIn(k, h - 1, in, t)) return false;
+            any = any || k;
+        }
+        n = c;
+    }
+    if (!any) return false; // empty subtrees are always written as 0
+    t.nodes.emplace_back(n, h);
+    return true;
+}
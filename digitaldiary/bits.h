@@ -0,0 +1,142 @@
+#pragma once
+
+#include "common.h"
+
+// ---------------------- Bit Vector -----------------------
+// Packed flags, 64 per word. Bits past size() are kept zero, so
+// count() is a plain popcount over the words.
+inline int bitCount(uint64_t x) {
+#if defined(__GNUC__) && defined(__POPCNT__)
+    return __builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+class BitVector {
+public:
+    size_t size() const { return n; }
+    bool test(size_t i) const { return (words[i >> 6] >> (i & 63)) & 1; }
+    void set(size_t i, bool v) {
+        uint64_t m = uint64_t(1) << (i & 63);
+        if (v) words[i >> 6] |= m;
+        else words[i >> 6] &= ~m;
+    }
+    void flip(size_t i) { words[i >> 6] ^= uint64_t(1) << (i & 63); }
+    void push_back(bool v) {
+        if ((n & 63) == 0) words.push_back(0);
+        set(n++, v);
+    }
+    void reserve(size_t bits) { words.reserve((bits + 63) / 64); }
+    void resize(size_t bits) {
+        words.resize((bits + 63) / 64, 0);
+        if (bits & 63) words.back() &= (uint64_t(1) << (bits & 63)) - 1;
+        n = bits;
+    }
+    // number of set bits
+    size_t count() const {
+        size_t c = 0;
+        for (uint64_t x : words) c += bitCount(x);
+        return c;
+    }
+    void clear() { words.clear(); words.shrink_to_fit(); n = 0; }
+    const vector<uint64_t>& bits() const { return words; }
+private:
+    vector<uint64_t> words;
+    size_t n = 0;
+};
+
+// ---------------------- Rank Tree ------------------------
+// Fenwick tree over per-slot counts (1 live, 0 erased): rank(k) counts
+// the live slots before k and select(i) finds the slot of the i-th
+// live one, both in O(log n). Appending a slot is amortized O(1).
+class RankTree {
+public:
+    void clear() { tree.clear(); tree.shrink_to_fit(); }
+    void reserve(size_t n) { tree.reserve(n); }
+    // n slots, all live
+    void fill(size_t n) {
+        tree.resize(n);
+        for (size_t i = 1; i <= n; ++i) tree[i - 1] = (uint32_t)lowBit(i);
+    }
+    void push_back(uint32_t v) {
+        size_t i = tree.size() + 1;
+        for (size_t step = 1; step < lowBit(i); step <<= 1) v += tree[i - step - 1];
+        tree.push_back(v);
+    }
+    void add(size_t k, int delta) {
+        for (size_t i = k + 1; i <= tree.size(); i += lowBit(i)) tree[i - 1] += (uint32_t)delta;
+    }
+    size_t rank(size_t k) const {
+        size_t r = 0;
+        for (size_t i = k; i > 0; i -= lowBit(i)) r += tree[i - 1];
+        return r;
+    }
+    size_t select(size_t pos) const {
+        size_t at = 0, step = 1;
+        while (step * 2 <= tree.size()) step <<= 1;
+        for (; step; step >>= 1) {
+            if (at + step <= tree.size() && tree[at + step - 1] <= pos) {
+                at += step;
+                pos -= tree[at - 1];
+            }
+        }
+        return at;
+    }
+private:
+    vector<uint32_t> tree;
+    static size_t lowBit(size_t i) { return i & (~i + 1); }
+};
+
+// ------------------- Persistent Bit Set ------------------
+// Immutable set of ids: a 16-way trie over 512-bit leaves in which an
+// all-zero subtree is a null pointer. with() and without() copy only
+// the nodes on the way to the bits they change and share every other
+// node with the set they started from, so many versions of a large set
+// cost O(log n) per change between them. diff() and unite() skip the
+// subtrees two versions share, so they cost O(changes), not O(n).
+class PersistentBits {
+public:
+    struct Node {};
+    using Ref = shared_ptr<const Node>;
+    // nodes saved or loaded so far, numbered in order, so versions stored
+    // together share their nodes on disk as they do in memory
+    struct Table {
+        unordered_map<const Node*, uint32_t> ids;
+        vector<pair<Ref, unsigned>> nodes; // node and its height
+    };
+    bool test(size_t id) const;
+    bool empty() const { return !root; }
+    // same nodes (equal sets may still differ in nodes)
+    bool same(const PersistentBits& o) const { return root == o.root; }
+    // this set with id added (on) or removed
+    PersistentBits with(size_t id, bool on) const;
+    // this set without the ids in sorted
+    PersistentBits without(const vector<uint32_t>& sorted) const;
+    // from a bitmap: id i is bit i % 64 of words[i / 64]
+    static PersistentBits fromWords(const vector<uint64_t>& words);
+    // ids in exactly one of a and b, ascending
+    static void diff(const PersistentBits& a, const PersistentBits& b, vector<uint32_t>& out);
+    static PersistentBits unite(const PersistentBits& a, const PersistentBits& b);
+    void save(string& out, Table& t) const;
+    bool load(string_view& in, Table& t);
+private:
+    static const unsigned FAN = 16, WORDS = 8, MAX_HEIGHT = 6; // 512 << 24 covers every u32 id
+    struct Leaf : Node { uint64_t w[WORDS] = {}; };
+    struct Inner : Node { Ref kid[FAN]; };
+    Ref root;
+    unsigned height = 0; // inner levels above the leaves
+    static uint64_t span(unsigned h) { return uint64_t(WORDS * 64) << (4 * h); }
+    static const Leaf* leaf(const Ref& n) { return static_cast<const Leaf*>(n.get()); }
+    static const Inner* inner(const Ref& n) { return static_cast<const Inner*>(n.get()); }
+    PersistentBits lifted(unsigned h) const;
+    static Ref setIn(const Ref& n, unsigned h, uint64_t id, bool on);
+    static Ref dropIn(const Ref& n, unsigned h, uint64_t base, const uint32_t* first, const uint32_t* last);
+    static void diffIn(const Ref& a, const Ref& b, unsigned h, uint64_t base, vector<uint32_t>& out);
+    static Ref uniteIn(const Ref& a, const Ref& b, unsigned h);
+    static void saveIn(const Ref& n, unsigned h, string& out, Table& t);
+    static bool loadIn(Ref& n, unsigned h, string_view& in, Table& t);
+};
@@ -0,0 +1,95 @@
+#include "codec.h"
+
+// ---------------------- LZ Codec -------------------------
+// LZ77 in LZ4-style sequences: a token (literal count << 4 | match
+// length - 4, 15 meaning more length bytes follow), the literals, then
+// a 16-bit offset and the extra match length bytes. The last sequence
+// has literals only. Greedy matching through a 4-byte hash table.
+void lzCompress(string_view in, string& out) {
+    const uint8_t* src = (const uint8_t*)in.data();
+    const size_t n = in.size();
+    vector<uint32_t> table(1 << 14, 0); // hash -> position + 1
+    auto putLength = [&](size_t len) {
+        for (; len >= 255; len -= 255) out += (char)255;
+        out += (char)len;
+    };
+    auto emit = [&](size_t from, size_t to, size_t offset, size_t match) {
+        size_t lit = to - from;
+        size_t m = match ? match - 4 : 0;
+        out += (char)((min<size_t>(lit, 15) << 4) | min<size_t>(m, 15));
+        if (lit >= 15) putLength(lit - 15);
+        out.append(in.data() + from, lit);
+        if (!match) return;
+        out += (char)(offset & 0xff);
+        out += (char)(offset >> 8);
+        if (m >= 15) putLength(m - 15);
+    };
+    size_t anchor = 0, i = 0;
+    while (i + 4 <= n) {
+        uint32_t word;
+        memcpy(&word, src + i, 4);
+        uint32_t h = (word * 2654435761u) >> 18;
+        size_t cand = table[h];
+        table[h] = (uint32_t)(i + 1);
+        uint32_t prev;
+        if (cand && i - (cand - 1) <= 0xffff && (memcpy(&prev, src + cand - 1, 4), prev == word)) {
+            size_t from = cand - 1, len = 4;
+            while (i + len < n && src[from + len] == src[i + len]) ++len;
+            emit(anchor, i, i - from, len);
+            i += len;
+            anchor = i;
+        } else {
+            ++i;
+        }
+    }
+    emit(anchor, n, 0, 0);
+}
+
+// false unless in decodes to exactly rawSize bytes and ends with a
+// literals-only sequence, so a block cut after any sequence is caught
+bool lzDecompress(string_view in, char* out, size_t rawSize) {
+    const uint8_t* ip = (const uint8_t*)in.data();
+    const uint8_t* end = ip + in.size();
+    size_t o = 0;
+    auto getLength = [&](size_t& len) {
+        uint8_t b;
+        do {
+            if (ip >= end) return false;
+            b = *ip++;
+            len += b;
+        } while (b == 255);
+        return true;
+    };
+    for (;;) {
+        if (ip == end) return false;
+        uint8_t token = *ip++;
+        size_t lit = token >> 4, match = token & 15;
+        if (lit == 15 && !getLength(lit)) return false;
+        if ((size_t)(end - ip) < lit || rawSize - o < lit) return false;
+        memcpy(out + o, ip, lit);
+        ip += lit;
+        o += lit;
+        if (ip == end) return match == 0 && o == rawSize; // last sequence
+        if (end - ip < 2) return false;
+        size_t offset = ip[0] | (size_t)ip[1] << 8;
+        ip += 2;
+        if (match == 15 && !getLength(match)) return false;
+        match += 4;
+        if (offset == 0 || offset > o || rawSize - o < match) return false;
+        for (size_t k = 0; k < match; ++k, ++o) out[o] = out[o - offset]; // may overlap
+    }
+}
+
+// ------------------ Packed Note Text --------------------
+string_view PackedText::text(uint32_t b) {
+    lock_guard<mutex> g(m);
+    if (b >= blocks.size()) return string_view();
+    Block& k = blocks[b];
+    if (!k.raw) {
+        STAT_TIME(STAT_INFLATE_BLOCK);
+        unique_ptr<char[]> raw(new char[max<uint32_t>(k.rawSize, 1)]);
+        if (!lzDecompress(string_view(k.data, k.packedSize), raw.get(), k.rawSize)) return string_view();
+        k.raw = move(raw);
+    }
+    return string_view(k.raw.get(), k.rawSize);
+}
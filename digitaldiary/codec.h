@@ -0,0 +1,45 @@
+#pragma once
+
+#include "common.h"
+
+// ---------------------- LZ Codec -------------------------
+// LZ block codec for packed note text (LZ4-style sequences)
+void lzCompress(string_view in, string& out);
+bool lzDecompress(string_view in, char* out, size_t rawSize);
+
+// ------------------ Packed Note Text --------------------
+// Note content loaded from a packed notes.bin: LZ blocks of about
+// PACK_BLOCK bytes of text, pointing into the mapped snapshot. A block
+// is inflated the first time one of its notes is read and kept from
+// then on, so loading costs nothing per note and viewing a page costs
+// at most a few blocks. Safe to read from several threads.
+class PackedText {
+public:
+    void clear() {
+        lock_guard<mutex> g(m);
+        blocks.clear();
+    }
+    void add(const char* data, uint32_t packedSize, uint32_t rawSize) {
+        lock_guard<mutex> g(m);
+        blocks.push_back(Block{data, packedSize, rawSize, nullptr});
+    }
+    // raw text of block b; empty if it does not inflate cleanly
+    string_view text(uint32_t b);
+private:
+    struct Block {
+        const char* data;
+        uint32_t packedSize, rawSize;
+        unique_ptr<char[]> raw;
+    };
+    vector<Block> blocks;
+    mutex m;
+};
+
+extern PackedText packedNotes;
+
+// a note's content, inflating its block if it is still packed
+inline string_view noteText(const Note& n) {
+    if (n.block == NO_BLOCK) return n.content;
+    string_view t = packedNotes.text(n.block);
+    return (uint64_t)n.offset + n.length <= t.size() ? t.substr(n.offset, n.length) : string_view();
+}
@@ -0,0 +1,132 @@
+#include "common.h"
+
+// --------------------- Configuration ---------------------
+uint32_t keyIterations = 100000;
+size_t undoDepth = 20;
+bool keepUndo = false;
+string NOTES_FILE, TASKS_FILE, CONTACTS_FILE;
+string NOTES_SNAPSHOT, TASKS_SNAPSHOT, CONTACTS_SNAPSHOT;
+string NOTES_INDEX;
+string NOTES_UNDO, TASKS_UNDO, CONTACTS_UNDO;
+string SERVER_SOCKET;
+string SHARD_LOCK;
+Durability durability = Durability::Interval;
+int syncIntervalMs = 100;
+NotePacking notePacking = NotePacking::Keep;
+
+thread_local DateText recordDates;
+thread_local DateText dueDates;
+
+// ---------------------- Utilities ------------------------
+// Remove trailing CR for Windows formatted files
+string trimCR(const string& s) {
+    if (!s.empty() && s.back() == '\r') return s.substr(0, s.size()-1);
+    return s;
+}
+
+//Return real time date/time in
+// the string format (dd/mm/yyyy hh:mm)
+string getDateTime() {
+    return formatDateTime(time(0));
+}
+
+// epoch seconds -> local time (safe to call from loader threads)
+bool localTime(int64_t t, tm& out) {
+    time_t tt = (time_t)t;
+#ifdef _WIN32
+    return localtime_s(&out, &tt) == 0;
+#else
+    return localtime_r(&tt, &out) != nullptr;
+#endif
+}
+
+// epoch seconds -> dd/mm/yyyy hh:mm
+string formatDateTime(int64_t t) {
+    tm ltm;
+    if (!localTime(t, ltm)) return string();
+    char buf[20];
+    //string format time
+    if (!strftime(buf, sizeof(buf), "%d/%m/%Y %H:%M", &ltm)) return string();
+    return string(buf);
+}
+
+// dd/mm/yyyy hh:mm -> epoch seconds. Only accepts strings that format
+// back to exactly the same text, so nothing is lost by storing the number.
+bool parseDateTime(string_view s, int64_t& t) {
+    if (s.size() != 16 || s[2] != '/' || s[5] != '/' || s[10] != ' ' || s[13] != ':') return false;
+    auto num = [&](size_t at, size_t len, int& v) {
+        v = 0;
+        for (size_t i = at; i < at + len; ++i) {
+            if (s[i] < '0' || s[i] > '9') return false;
+            v = v * 10 + (s[i] - '0');
+        }
+        return true;
+    };
+    tm when = {};
+    int d, m, y, hh, mm;
+    if (!num(0, 2, d) || !num(3, 2, m) || !num(6, 4, y) || !num(11, 2, hh) || !num(14, 2, mm)) return false;
+    when.tm_mday = d; when.tm_mon = m - 1; when.tm_year = y - 1900;
+    when.tm_hour = hh; when.tm_min = mm; when.tm_isdst = -1;
+    time_t tt = mktime(&when);
+    if (tt == (time_t)-1) return false;
+    t = (int64_t)tt;
+    return formatDateTime(t) == s;
+}
+
+// dd/mm/yyyy -> first and last second of that day
+bool parseDay(string_view s, int64_t& first, int64_t& last) {
+    string day(s);
+    if (!parseDateTime(day + " 00:00", first) || !parseDateTime(day + " 23:59", last)) return false;
+    last += 59;
+    return true;
+}
+
+int64_t currentMinute() {
+    int64_t t = (int64_t)time(0);
+    return t - t % 60;
+}
+
+string_view DateText::format(int64_t t) {
+    if (t >= dayStart && t < dayEnd) {
+        int64_t m = (t - dayStart) / 60;
+        buf[11] = char('0' + m / 600);
+        buf[12] = char('0' + m / 60 % 10);
+        buf[14] = char('0' + m % 60 / 10);
+        buf[15] = char('0' + m % 10);
+        return string_view(buf, len);
+    }
+    dayStart = dayEnd = 0;
+    tm lt, first, last;
+    len = 0;
+    if (!localTime(t, lt)) return string_view();
+    len = strftime(buf, sizeof(buf), "%d/%m/%Y %H:%M", &lt);
+    // cache the day if it runs 00:00 to 23:59 in 24 plain hours
+    int64_t start = t - (lt.tm_hour * 3600 + lt.tm_min * 60 + lt.tm_sec);
+    if (len == 16 && localTime(start, first) && localTime(start + 86400 - 60, last)
+        && first.tm_hour == 0 && first.tm_min == 0 && first.tm_mday == lt.tm_mday
+        && last.tm_hour == 23 && last.tm_min == 59 && last.tm_mday == lt.tm_mday) {
+        dayStart = start;
+        dayEnd = start + 86400;
+    }
+    return string_view(buf, len);
+}
+
+//enabling console colours
+//to enable windows support for
+//Unix-based ANSI colours
+//(other terminals understand them already)
+void enableAnsi() {
+#ifdef _WIN32
+    HANDLE h = GetStdHandle(STD_OUTPUT_HANDLE);
+    if (h == INVALID_HANDLE_VALUE) return;
+    DWORD mode = 0;
+    if (!GetConsoleMode(h, &mode)) return;
+    SetConsoleMode(h, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+#endif
+}
+
+// Safe read whole line after using >> or similar
+void safeIgnoreNewline() {
+    if (cin.peek() == '\n') cin.ignore(); 
+	//peek looks at next character
+}
@@ -0,0 +1,306 @@
+//------------*******MINI DIGITAL DIARY*******--------
+//A console friendly application for saving multi-line notes, to-do tasks and contacts
+//comes with a user authentication system to ensure security in personal diary.
+
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <ctime>
+#include <iomanip>
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <string_view>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <cstdint>
+#include <filesystem>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <atomic>
+#include <condition_variable>
+#include <shared_mutex>
+#include <deque>
+//to map each user to his key
+#include <unordered_map>
+#include <tuple>
+#include <type_traits>
+//to add colors to console
+#ifdef _WIN32
+#include <windows.h>
+#endif
+//fsync / _commit for durable compaction, mmap for loading
+#ifdef _WIN32
+#include <io.h>
+#include <conio.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <signal.h>
+#ifdef DIARY_BENCH
+#include <sys/resource.h>
+#include <sys/wait.h>
+#endif
+#endif
+
+using namespace std;
+
+// --------------------- Configuration ---------------------
+const string INDENT = "                      "; // soft left padding
+const string USERS_FILE = "users.txt";
+const string USERS_INDEX = "users.idx"; // name hash -> line in USERS_FILE
+// PBKDF2 iterations for newly stored keys (--key-iterations N); keys
+// stored with another count are rehashed at their next login
+extern uint32_t keyIterations;
+// undo steps kept per store (--undo-depth N, 0 turns undo off) and
+// whether they carry over to the next session (--keep-undo on)
+extern size_t undoDepth;
+extern bool keepUndo;
+// each user's data lives in its own shard: DATA_DIR/<encoded name>/
+const string DATA_DIR = "diary_data";
+// Paths inside the logged-in user's shard, set once by openUserShard().
+// notes.bin etc. are binary snapshots of the text logs for fast start-up,
+// notes.idx is the inverted index over note content, notes.undo etc.
+// the undo history kept with --keep-undo on.
+extern string NOTES_FILE, TASKS_FILE, CONTACTS_FILE;
+extern string NOTES_SNAPSHOT, TASKS_SNAPSHOT, CONTACTS_SNAPSHOT;
+extern string NOTES_INDEX;
+extern string NOTES_UNDO, TASKS_UNDO, CONTACTS_UNDO;
+extern string SERVER_SOCKET; // where --serve listens by default (POSIX)
+extern string SHARD_LOCK;    // flocked by whoever has the shard open (POSIX)
+const size_t SEARCH_LIMIT = 20; // newest matches shown per search
+const size_t PAGE_SIZE = 10;    // default records per page in list views
+// logs at least this big are parsed in parallel chunks on load
+const size_t PARALLEL_MIN_BYTES = 8 << 20;
+// compact a store log once dead entries outnumber live records by this ratio
+const double COMPACT_RATIO = 1.0;
+const size_t COMPACT_MIN = 64; // ...and there are at least this many of them
+// held (batch / import) appends are written out once they reach this size
+const size_t HOLD_FLUSH_BYTES = 4 << 20;
+// How log appends reach the disk (--durability none | op | MS):
+//   None     - buffered, written once 64 KiB collect and at exit; never fsynced
+//   Interval - buffered; written and fsynced together every syncIntervalMs
+//   PerOp    - written and fsynced before the append returns
+enum class Durability { None, Interval, PerOp };
+extern Durability durability;
+extern int syncIntervalMs;
+const size_t LOG_BUFFER_BYTES = 64 << 10;
+// export output is written in chunks of this size
+const size_t EXPORT_CHUNK = 1 << 20;
+// imported records are parsed ahead and stored this many at a time
+const size_t IMPORT_CHUNK = 1024;
+// Note content in notes.bin (--pack-notes on|off): On stores it as LZ
+// compressed blocks that are inflated when a note is first read, Off as
+// plain text, Keep writes whichever form notes.bin already has
+enum class NotePacking { Keep, On, Off };
+extern NotePacking notePacking;
+const size_t PACK_BLOCK = 64 << 10; // raw note text per compressed block
+
+// --------------------- ANSI Color Macros ------------------
+#define RESET "\033[0m"
+#define RED "\033[31m"
+#define YELLOW "\033[33m"
+#define CYAN "\033[36m"
+#define WHITE "\033[37m"
+#define BG_BLUE_WHITE "\033[44;37m"
+#define BOLD "\033[1m"
+#define GREEN "\033[32m"
+
+// ---------------------- Statistics -----------------------
+// Per-operation latency histograms and I/O counters, shown by the Stats
+// menu and written on exit to $DIARY_STATS_FILE when it is set. Updates
+// are relaxed atomics plus one clock read per timed call; build with
+// -DDIARY_NO_STATS to compile them out entirely.
+enum StatOp {
+    STAT_LOAD_NOTES, STAT_LOAD_TASKS, STAT_LOAD_CONTACTS,
+    STAT_REWRITE_NOTES, STAT_REWRITE_TASKS, STAT_REWRITE_CONTACTS,
+    STAT_APPEND_NOTE, STAT_APPEND_TASK, STAT_APPEND_CONTACT,
+    STAT_VIEW_NOTES, STAT_VIEW_TASKS, STAT_VIEW_CONTACTS,
+    STAT_USER_LOOKUP, STAT_KEY_DERIVE,
+    STAT_SERVE_READ, STAT_SERVE_WRITE, STAT_INFLATE_BLOCK,
+    STAT_OPS
+};
+const char* const STAT_NAMES[STAT_OPS] = {
+    "load_notes", "load_tasks", "load_contacts",
+    "rewrite_notes", "rewrite_tasks", "rewrite_contacts",
+    "append_note", "append_task", "append_contact",
+    "view_notes", "view_tasks", "view_contacts",
+    "user_lookup", "key_derive",
+    "serve_read", "serve_write", "inflate_block"};
+const int STAT_BUCKETS = 32; // bucket b counts calls under 2^b microseconds
+
+struct OpStats {
+    atomic<uint64_t> count{0}, totalNs{0}, maxNs{0};
+    atomic<uint64_t> buckets[STAT_BUCKETS] = {};
+};
+
+struct IoStats {
+    atomic<uint64_t> fileOpens{0}, bytesRead{0}, bytesWritten{0};
+};
+
+extern OpStats opStats[STAT_OPS];
+extern IoStats ioStats;
+
+#ifndef DIARY_NO_STATS
+inline void statRecord(StatOp op, uint64_t ns) {
+    OpStats& s = opStats[op];
+    s.count.fetch_add(1, memory_order_relaxed);
+    s.totalNs.fetch_add(ns, memory_order_relaxed);
+    uint64_t m = s.maxNs.load(memory_order_relaxed);
+    while (ns > m && !s.maxNs.compare_exchange_weak(m, ns, memory_order_relaxed)) {}
+    int b = 0;
+    for (uint64_t us = ns / 1000; us && b < STAT_BUCKETS - 1; us >>= 1) ++b;
+    s.buckets[b].fetch_add(1, memory_order_relaxed);
+}
+
+// times the enclosing scope as one call of op
+class StatTimer {
+public:
+    explicit StatTimer(StatOp op) : op(op), start(chrono::steady_clock::now()) {}
+    ~StatTimer() {
+        auto ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+        statRecord(op, (uint64_t)ns);
+    }
+private:
+    StatOp op;
+    chrono::steady_clock::time_point start;
+};
+#define STAT_TIME(op) StatTimer statTimer(op)
+#define STAT_IO(field, n) ioStats.field.fetch_add((uint64_t)(n), memory_order_relaxed)
+#else
+#define STAT_TIME(op) ((void)0)
+#define STAT_IO(field, n) ((void)0)
+#endif
+
+// --------------------- Data Structures -------------------
+// Record strings are views into the owning store's arena (see below),
+// so copying a record never allocates.
+// seq is the ordinal of the record's add entry in its log file.
+// created is the date as epoch seconds; the text is formatted from it
+// when needed. If the text does not parse, created is NO_TIME and the
+// text is kept in the store's oddDates (oddDate 0 is the empty date).
+// A task's done flag lives in the store's done bits.
+const int64_t NO_TIME = INT64_MIN;
+
+const uint32_t NO_BLOCK = UINT32_MAX;
+
+struct Note {
+    string_view content;    // multi-line content (contains '\n'), read it through noteText()
+    int64_t created;        // when the note was added
+    uint32_t seq;
+    uint32_t oddDate;
+    // content still compressed in a packed notes.bin: block in
+    // packedNotes, offset and length there (content stays empty)
+    uint32_t block = NO_BLOCK;
+    uint32_t offset = 0, length = 0;
+};
+
+struct Task {
+    string_view text;      // single-line task description
+    int64_t created;       // when added (dd/mm/yyyy hh:mm)
+    uint32_t seq;
+    uint32_t oddDate;
+    uint32_t due = 0;      // due time in minutes since the epoch, 0 if none
+    uint8_t priority = 0;  // 1 high, 2 normal, 3 low, 0 if none
+};
+
+// a task's due time in epoch seconds, NO_TIME if it has none
+inline int64_t taskDue(const Task& t) { return t.due ? int64_t(t.due) * 60 : NO_TIME; }
+// due time t as kept in Task::due (NO_TIME gives 0); false if out of range
+inline bool dueMinutes(int64_t t, uint32_t& m) {
+    if (t == NO_TIME) { m = 0; return true; }
+    if (t < 60 || t / 60 > UINT32_MAX) return false;
+    m = uint32_t(t / 60);
+    return true;
+}
+
+struct Contact {
+    string_view name;
+    string_view phone;
+    int64_t created;       // when added
+    uint32_t seq;
+    uint32_t oddDate;
+};
+
+// ---------------------- Date Text ------------------------
+// Formats epoch seconds as dd/mm/yyyy hh:mm like formatDateTime.
+// Records come in time order, so the local day of the last call is
+// kept and a time inside it only needs its hh:mm filled in; days with
+// a clock change are formatted in full each time.
+class DateText {
+public:
+    // valid until the next call
+    string_view format(int64_t t);
+private:
+    int64_t dayStart = 0, dayEnd = 0; // cached local day [start, end)
+    char buf[20] = {};
+    size_t len = 0;
+};
+extern thread_local DateText recordDates; // used by recordDate
+extern thread_local DateText dueDates;    // due dates in logs and exports
+
+// A record's date text: formatted from created, or the kept text of a
+// date that does not parse. Formatted ones stay valid until the next
+// call on the same thread.
+template <typename T>
+string_view recordDate(const T& r, const vector<string_view>& oddDates) {
+    return r.created != NO_TIME ? recordDates.format(r.created) : oddDates[r.oddDate];
+}
+
+// ----------- Utilities --------------
+// Remove trailing CR for Windows formatted files
+string trimCR(const string& s);
+// Return current date/time as dd/mm/yyyy hh:mm
+string getDateTime();
+// Epoch seconds to local broken-down time
+bool localTime(int64_t t, tm& out);
+// Format epoch seconds as dd/mm/yyyy hh:mm (local time)
+string formatDateTime(int64_t t);
+// Parse dd/mm/yyyy hh:mm into epoch seconds; false unless it round-trips exactly
+bool parseDateTime(string_view s, int64_t& t);
+// First and last second of a dd/mm/yyyy day
+bool parseDay(string_view s, int64_t& first, int64_t& last);
+// Current time at the minute resolution dates are stored with
+int64_t currentMinute();
+//Enable ANSI escape sequences on Windows console 
+void enableAnsi();
+// Safe read whole line after using >> or similar
+void safeIgnoreNewline() ;
+
+// parseDateTime with a one-entry cache: log records come in time
+// order, so runs of them share the same minute text
+struct DateCache {
+    string_view text;
+    int64_t value = NO_TIME;
+    bool primed = false;
+    int64_t get(string_view s) {
+        if (!primed || s != text) {
+            primed = true;
+            text = s;
+            if (!parseDateTime(s, value)) value = NO_TIME;
+        }
+        return value;
+    }
+};
+
+// -------------------- Stats View ------------------------
+// Print the operation and I/O table (main menu "Stats")
+void showStats();
+// Write the counters as JSON to $DIARY_STATS_FILE, if set
+void dumpStats();
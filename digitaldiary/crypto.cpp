@@ -0,0 +1,166 @@
+#include "crypto.h"
+
+// ---------------------- Users ----------------------------
+static const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static inline uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+Sha256::Sha256() {
+    static const uint32_t init[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                     0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    memcpy(h, init, sizeof(h));
+}
+
+void Sha256::compress(const uint8_t* p) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; ++i)
+        w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 | (uint32_t)p[4 * i + 2] << 8 | p[4 * i + 3];
+    for (int i = 16; i < 64; ++i) {
+        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+    for (int i = 0; i < 64; ++i) {
+        uint32_t t1 = k + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[i] + w[i];
+        uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        k = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+}
+
+void Sha256::update(const void* data, size_t n) {
+    if (!n) return; // data may be null
+    const uint8_t* p = (const uint8_t*)data;
+    total += n;
+    if (used) {
+        size_t take = min(n, 64 - used);
+        memcpy(block + used, p, take);
+        used += take; p += take; n -= take;
+        if (used < 64) return;
+        compress(block);
+        used = 0;
+    }
+    for (; n >= 64; p += 64, n -= 64) compress(p);
+    memcpy(block, p, n);
+    used = n;
+}
+
+void Sha256::finish(uint8_t out[32]) {
+    uint64_t bits = total * 8;
+    uint8_t pad[72] = {0x80};
+    size_t padLen = (used < 56 ? 56 : 120) - used;
+    for (int i = 0; i < 8; ++i) pad[padLen + i] = (uint8_t)(bits >> (56 - 8 * i));
+    update(pad, padLen + 8);
+    for (int i = 0; i < 8; ++i)
+        for (int j = 0; j < 4; ++j) out[4 * i + j] = (uint8_t)(h[i] >> (24 - 8 * j));
+}
+
+// The HMAC inner and outer states are hashed once up front, so each
+// iteration costs two compressions.
+void pbkdf2Sha256(string_view key, string_view salt, uint32_t iterations, uint8_t out[32]) {
+    STAT_TIME(STAT_KEY_DERIVE);
+    uint8_t pad[64] = {0};
+    if (key.size() > 64) {
+        Sha256 kh;
+        kh.update(key.data(), key.size());
+        kh.finish(pad);
+    } else {
+        memcpy(pad, key.data(), key.size());
+    }
+    Sha256 inner, outer;
+    uint8_t ipad[64], opad[64];
+    for (int i = 0; i < 64; ++i) { ipad[i] = pad[i] ^ 0x36; opad[i] = pad[i] ^ 0x5c; }
+    inner.update(ipad, 64);
+    outer.update(opad, 64);
+    auto hmac = [&](const uint8_t* a, size_t an, const uint8_t* b, size_t bn, uint8_t* mac) {
+        Sha256 s = inner;
+        s.update(a, an);
+        s.update(b, bn);
+        s.finish(mac);
+        s = outer;
+        s.update(mac, 32);
+        s.finish(mac);
+    };
+    const uint8_t one[4] = {0, 0, 0, 1};
+    uint8_t u[32];
+    hmac((const uint8_t*)salt.data(), salt.size(), one, 4, u);
+    memcpy(out, u, 32);
+    for (uint32_t i = 1; i < iterations; ++i) {
+        hmac(u, 32, nullptr, 0, u);
+        for (int j = 0; j < 32; ++j) out[j] ^= u[j];
+    }
+}
+
+static const char KEY_HASH_PREFIX[] = "$pbkdf2-sha256$";
+
+static string toHex(const uint8_t* p, size_t n) {
+    static const char* hex = "0123456789abcdef";
+    string out;
+    for (size_t i = 0; i < n; ++i) { out += hex[p[i] >> 4]; out += hex[p[i] & 15]; }
+    return out;
+}
+
+static bool fromHex(string_view s, string& out) {
+    if (s.size() % 2) return false;
+    out.clear();
+    for (size_t i = 0; i < s.size(); i += 2) {
+        int v = 0;
+        for (size_t j = i; j < i + 2; ++j) {
+            char c = s[j];
+            int d = isdigit((unsigned char)c) ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : -1;
+            if (d < 0) return false;
+            v = v * 16 + d;
+        }
+        out += (char)v;
+    }
+    return true;
+}
+
+// "$pbkdf2-sha256$ITER$SALT$HASH" (hex); false for anything else
+bool parseCredential(string_view cred, uint32_t& iterations, string& salt, string& hash) {
+    if (cred.substr(0, sizeof(KEY_HASH_PREFIX) - 1) != KEY_HASH_PREFIX) return false;
+    cred.remove_prefix(sizeof(KEY_HASH_PREFIX) - 1);
+    size_t a = cred.find('$'), b = a == string_view::npos ? a : cred.find('$', a + 1);
+    if (b == string_view::npos || a == 0 || a > 9) return false;
+    iterations = 0;
+    for (char c : cred.substr(0, a)) {
+        if (!isdigit((unsigned char)c)) return false;
+        iterations = iterations * 10 + (uint32_t)(c - '0');
+    }
+    return iterations > 0 && fromHex(cred.substr(a + 1, b - a - 1), salt)
+        && fromHex(cred.substr(b + 1), hash) && hash.size() == 32;
+}
+
+string hashKey(const string& key, uint32_t iterations) {
+    random_device rd;
+    uint8_t salt[16];
+    for (size_t i = 0; i < sizeof(salt); i += 4) {
+        uint32_t r = rd();
+        memcpy(salt + i, &r, 4);
+    }
+    uint8_t hash[32];
+    pbkdf2Sha256(key, string_view((const char*)salt, sizeof(salt)), iterations, hash);
+    return KEY_HASH_PREFIX + to_string(iterations) + "$" + toHex(salt, sizeof(salt)) + "$" + toHex(hash, sizeof(hash));
+}
+
+bool checkKey(const string& credential, const string& key) {
+    uint32_t iterations;
+    string salt, hash;
+    if (!parseCredential(credential, iterations, salt, hash)) return credential == key;
+    uint8_t got[32];
+    pbkdf2Sha256(key, salt, iterations, got);
+    uint8_t diff = 0; // compare every byte, whatever matches first
+    for (int i = 0; i < 32; ++i) diff |= got[i] ^ (uint8_t)hash[i];
+    return diff == 0;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "common.h"
+
+// ---------------------- Users ----------------------------
+// SHA-256 (FIPS 180-4), used for key hashing
+class Sha256 {
+public:
+    Sha256();
+    void update(const void* data, size_t n);
+    void finish(uint8_t out[32]);
+private:
+    uint32_t h[8];
+    uint8_t block[64];
+    uint64_t total = 0;
+    size_t used = 0;
+    void compress(const uint8_t* p);
+};
+// PBKDF2-HMAC-SHA256 (RFC 8018) with a 32 byte result
+void pbkdf2Sha256(string_view key, string_view salt, uint32_t iterations, uint8_t out[32]);
+// Salted hash of a secret key, as stored in USERS_FILE
+string hashKey(const string& key, uint32_t iterations);
+// true if key matches a stored credential (hashed, or plain text from older versions)
+bool checkKey(const string& credential, const string& key);
+// Split a "$pbkdf2-sha256$ITER$SALT$HASH" credential; false for anything else
+bool parseCredential(string_view cred, uint32_t& iterations, string& salt, string& hash);
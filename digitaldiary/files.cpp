@@ -0,0 +1,62 @@
+#include "files.h"
+
+// --------------------- File Helpers ----------------------
+// flush and force file contents to disk
+bool syncFile(FILE* f) {
+    bool ok = fflush(f) == 0;
+#ifdef _WIN32
+    ok = _commit(_fileno(f)) == 0 && ok;
+#else
+    ok = fsync(fileno(f)) == 0 && ok;
+#endif
+    return ok;
+}
+
+// flush and force file contents to disk before closing
+bool syncClose(FILE* f) {
+    bool ok = syncFile(f);
+    return fclose(f) == 0 && ok;
+}
+
+// rename tmp over path in one step
+bool replaceFile(const string& tmp, const string& path) {
+#ifdef _WIN32
+    return MoveFileExA(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return rename(tmp.c_str(), path.c_str()) == 0;
+#endif
+}
+
+// Write data to path+".tmp", fsync it and rename it over path,
+// so readers see either the old file or the new one, never a torn one
+bool writeFileAtomic(const string& path, const string& data) {
+    string tmp = path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (!f) return false;
+    STAT_IO(fileOpens, 1);
+    STAT_IO(bytesWritten, data.size());
+    bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    ok = syncClose(f) && ok;
+    if (ok) ok = replaceFile(tmp, path);
+    if (!ok) remove(tmp.c_str());
+    return ok;
+}
+
+// size of a file, -1 if it does not exist
+int64_t fileSize(const string& path) {
+    error_code ec;
+    auto n = filesystem::file_size(path, ec);
+    return ec ? -1 : (int64_t)n;
+}
+
+// true if a file derived from a text log (snapshot, index) is at least
+// as new as the log and was built when the log had recordedSize bytes
+bool derivedFileCurrent(const string& textPath, const string& derivedPath, uint64_t recordedSize) {
+    int64_t textSize = fileSize(textPath);
+    if ((int64_t)recordedSize != max<int64_t>(textSize, 0)) return false;
+    if (textSize < 0) return true;
+    error_code e1, e2;
+    auto tText = filesystem::last_write_time(textPath, e1);
+    auto tDerived = filesystem::last_write_time(derivedPath, e2);
+    return !e1 && !e2 && tDerived >= tText;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "common.h"
+
+// --------------------- Mapped File -----------------------
+// Read-only image of a whole data file. Mapped with mmap where
+// available, otherwise read into one buffer. Loaders index records as
+// views into it, so it must outlive the records that point into it.
+class MappedFile {
+public:
+    MappedFile() {}
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() {
+#ifndef _WIN32
+        if (mapped) munmap((void*)ptr, len);
+#endif
+    }
+    bool open(const string& path) {
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        STAT_IO(fileOpens, 1);
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+                ptr = (const char*)p;
+                len = (size_t)st.st_size;
+                mapped = true;
+                STAT_IO(bytesRead, len);
+            }
+        }
+        ::close(fd);
+        if (mapped || st.st_size == 0) return true;
+#endif
+        // no mmap: one read into a single buffer
+        ifstream fin(path, ios::binary);
+        if (!fin) return false;
+        buf.assign(istreambuf_iterator<char>(fin), istreambuf_iterator<char>());
+        ptr = buf.data();
+        len = buf.size();
+        STAT_IO(fileOpens, 1);
+        STAT_IO(bytesRead, len);
+        return true;
+    }
+    string_view view() const { return string_view(ptr, len); }
+private:
+    const char* ptr = nullptr;
+    size_t len = 0;
+    bool mapped = false;
+    vector<char> buf;
+};
+
+// Splits a loaded file into lines exactly like getline + trimCR,
+// without copying: each line is a view into the file image.
+struct LineReader {
+    string_view buf;
+    size_t pos = 0;
+    explicit LineReader(string_view b) : buf(b) {}
+    bool next(string_view& line) {
+        if (pos >= buf.size()) return false;
+        size_t end = buf.find('\n', pos);
+        if (end == string_view::npos) end = buf.size();
+        line = buf.substr(pos, end - pos);
+        pos = end + 1;
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        return true;
+    }
+};
+
+// --------------------- File Helpers ----------------------
+// host-order integers in the binary images
+template <typename V>
+inline void putRaw(string& out, V v) { out.append((const char*)&v, sizeof(v)); }
+template <typename V>
+inline V getRaw(const char* p) { V v; memcpy(&v, p, sizeof(v)); return v; }
+// Flush and fsync a file (and close it)
+bool syncFile(FILE* f);
+bool syncClose(FILE* f);
+// Rename tmp over path in one step
+bool replaceFile(const string& tmp, const string& path);
+// Write data to path+".tmp", fsync it and rename it over path
+bool writeFileAtomic(const string& path, const string& data);
+// Size of a file, -1 if it does not exist
+int64_t fileSize(const string& path);
+// true if a file derived from a text log (snapshot, index) is current
+bool derivedFileCurrent(const string& textPath, const string& derivedPath, uint64_t recordedSize);
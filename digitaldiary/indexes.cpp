@@ -0,0 +1,399 @@
+#include "indexes.h"
+#include "stores.h"
+
+// ------------------- Note Search Index -------------------
+// notes.idx: magic "DDIX", u16 version, u16 pad, u64 notes.txt size,
+// u64 log adds, u64 term count, then per term
+// { u32 length, bytes, u32 count, count x u32 seq }
+const char INDEX_MAGIC[4] = {'D', 'D', 'I', 'X'};
+const uint16_t INDEX_VERSION = 1;
+
+// Calls f(token) for each lowercase word in text. Letters and digits
+// form words; bytes >= 0x80 count as letters so UTF-8 words stay whole.
+template <typename F>
+void forEachToken(string_view text, F f) {
+    string tok;
+    for (char ch : text) {
+        unsigned char c = (unsigned char)ch;
+        if (isalnum(c) || c >= 0x80) tok += (char)tolower(c);
+        else if (!tok.empty()) { f(tok); tok.clear(); }
+    }
+    if (!tok.empty()) f(tok);
+}
+
+// notes are added in increasing seq order, so appending keeps lists sorted
+void NoteIndex::add(size_t seq, string_view content) {
+    forEachToken(content, [&](const string& tok) {
+        vector<uint32_t>& list = postings[tok];
+        if (list.empty() || list.back() != seq) list.push_back((uint32_t)seq);
+    });
+}
+
+void NoteIndex::restore(const vector<pair<uint32_t, string_view>>& back) {
+    unordered_map<string, vector<uint32_t>> added;
+    for (const auto& n : back)
+        forEachToken(n.second, [&](const string& tok) {
+            vector<uint32_t>& list = added[tok];
+            if (list.empty() || list.back() != n.first) list.push_back(n.first);
+        });
+    vector<uint32_t> merged;
+    for (auto& a : added) {
+        vector<uint32_t>& list = postings[a.first];
+        sort(a.second.begin(), a.second.end());
+        merged.clear();
+        set_union(list.begin(), list.end(), a.second.begin(), a.second.end(), back_inserter(merged));
+        list.swap(merged);
+    }
+}
+
+void NoteIndex::prune(const vector<char>& alive) {
+    for (auto it = postings.begin(); it != postings.end();) {
+        vector<uint32_t>& list = it->second;
+        size_t w = 0;
+        for (uint32_t s : list)
+            if (s < alive.size() && alive[s]) list[w++] = s;
+        list.resize(w);
+        if (list.empty()) it = postings.erase(it);
+        else ++it;
+    }
+}
+
+// Words are ANDed; a "quoted phrase" also requires its words to appear
+// consecutively. Walks the shortest posting list from the newest end
+// and probes the others, so common words stop after limit hits.
+vector<size_t> NoteIndex::search(const string& query, size_t limit) const {
+    vector<string> words;
+    vector<vector<string>> phrases;
+    bool quoted = false;
+    size_t from = 0;
+    for (size_t i = 0; i <= query.size(); ++i) {
+        if (i < query.size() && query[i] != '"') continue;
+        string_view part = string_view(query).substr(from, i - from);
+        vector<string> toks;
+        forEachToken(part, [&](const string& t) { toks.push_back(t); words.push_back(t); });
+        if (quoted && toks.size() > 1) phrases.push_back(toks);
+        quoted = !quoted;
+        from = i + 1;
+    }
+    vector<size_t> hits;
+    if (words.empty()) return hits;
+    vector<const vector<uint32_t>*> lists;
+    for (const string& w : words) {
+        auto it = postings.find(w);
+        if (it == postings.end()) return hits;
+        lists.push_back(&it->second);
+    }
+    sort(lists.begin(), lists.end(), [](auto a, auto b) { return a->size() < b->size(); });
+    vector<string> toks;
+    const vector<uint32_t>& first = *lists[0];
+    for (size_t k = first.size(); k-- > 0 && hits.size() < limit;) {
+        uint32_t seq = first[k];
+        bool all = true;
+        for (size_t j = 1; j < lists.size() && all; ++j)
+            all = binary_search(lists[j]->begin(), lists[j]->end(), seq);
+        if (!all) continue;
+        size_t at = notes.indexOfSeq(seq);
+        if (at == SIZE_MAX) continue; // deleted since it was indexed
+        if (!phrases.empty()) {
+            // verify phrases against the note's own token sequence
+            toks.clear();
+            forEachToken(noteText(notes[at]), [&](const string& t) { toks.push_back(t); });
+            for (const vector<string>& p : phrases) {
+                all = std::search(toks.begin(), toks.end(), p.begin(), p.end()) != toks.end();
+                if (!all) break;
+            }
+            if (!all) continue;
+        }
+        hits.push_back(seq);
+    }
+    return hits;
+}
+
+bool NoteIndex::save(const string& path, uint64_t textSize, uint64_t adds) const {
+    string out;
+    out.append(INDEX_MAGIC, 4);
+    putRaw<uint16_t>(out, INDEX_VERSION);
+    putRaw<uint16_t>(out, 0);
+    putRaw<uint64_t>(out, textSize);
+    putRaw<uint64_t>(out, adds);
+    putRaw<uint64_t>(out, postings.size());
+    for (const auto& p : postings) {
+        putRaw<uint32_t>(out, (uint32_t)p.first.size());
+        out += p.first;
+        putRaw<uint32_t>(out, (uint32_t)p.second.size());
+        out.append((const char*)p.second.data(), p.second.size() * sizeof(uint32_t));
+    }
+    return writeFileAtomic(path, out);
+}
+
+// true if an index image was saved for the current notes log
+static bool indexCurrent(string_view v, const string& path, const string& textPath, uint64_t adds) {
+    return v.size() >= 32 && memcmp(v.data(), INDEX_MAGIC, 4) == 0
+        && getRaw<uint16_t>(v.data() + 4) == INDEX_VERSION
+        && getRaw<uint64_t>(v.data() + 16) == adds
+        && derivedFileCurrent(textPath, path, getRaw<uint64_t>(v.data() + 8));
+}
+
+// loads the index if it was saved for the current notes log
+bool NoteIndex::load(const string& path, const string& textPath, uint64_t adds) {
+    clear();
+    MappedFile img;
+    if (!img.open(path)) return false;
+    string_view v = img.view();
+    if (!indexCurrent(v, path, textPath, adds)) return false;
+    uint64_t terms = getRaw<uint64_t>(v.data() + 24);
+    const char* p = v.data() + 32;
+    const char* end = v.data() + v.size();
+    postings.reserve(terms);
+    for (uint64_t i = 0; i < terms; ++i) {
+        if (end - p < 4) { clear(); return false; }
+        uint32_t len = getRaw<uint32_t>(p); p += 4;
+        if ((uint64_t)(end - p) < (uint64_t)len + 4) { clear(); return false; }
+        string term(p, len); p += len;
+        uint32_t n = getRaw<uint32_t>(p); p += 4;
+        if ((uint64_t)(end - p) < (uint64_t)n * 4) { clear(); return false; }
+        vector<uint32_t>& list = postings[term];
+        list.resize(n);
+        memcpy(list.data(), p, (size_t)n * 4);
+        p += (size_t)n * 4;
+    }
+    return true;
+}
+
+// Load notes.idx, or rebuild it from the loaded notes when stale
+void openNoteIndex() {
+    if (noteIndex.load(NOTES_INDEX, NOTES_FILE, notes.log.adds)) return;
+    noteIndex.clear();
+    for (size_t i = 0; i < notes.size(); ++i) noteIndex.add(notes[i].seq, noteText(notes[i]));
+}
+
+// Write notes.idx unless the one on disk still matches notes.txt
+void saveNoteIndex() {
+    if (!notes.loaded) return;
+    logWait(notes.log);
+    {
+        MappedFile img;
+        if (img.open(NOTES_INDEX) && indexCurrent(img.view(), NOTES_INDEX, NOTES_FILE, notes.log.adds)) return;
+    }
+    noteIndex.prune(notes.liveSeqs());
+    noteIndex.save(NOTES_INDEX, (uint64_t)max<int64_t>(fileSize(NOTES_FILE), 0), notes.log.adds);
+}
+
+// ------------------- Contact Lookup Index ----------------
+uint32_t PrefixTrie::newNode(string label) {
+    uint32_t n;
+    if (!freeNodes.empty()) { n = freeNodes.back(); freeNodes.pop_back(); nodes[n] = Node(); }
+    else { n = (uint32_t)nodes.size(); nodes.emplace_back(); }
+    nodes[n].label = move(label);
+    return n;
+}
+
+// position of the child starting with c in nodes[n].kids, or -1
+int PrefixTrie::kidIndex(uint32_t n, char c) const {
+    const auto& kids = nodes[n].kids;
+    auto it = lower_bound(kids.begin(), kids.end(), c, [](const pair<char, uint32_t>& k, char x) { return k.first < x; });
+    return (it != kids.end() && it->first == c) ? int(it - kids.begin()) : -1;
+}
+
+void PrefixTrie::insert(string_view key, uint32_t id) {
+    uint32_t n = 0;
+    size_t i = 0;
+    while (i < key.size()) {
+        int k = kidIndex(n, key[i]);
+        if (k < 0) {
+            uint32_t leaf = newNode(string(key.substr(i)));
+            nodes[leaf].ids.push_back(id);
+            auto& kids = nodes[n].kids;
+            kids.insert(lower_bound(kids.begin(), kids.end(), make_pair(key[i], 0u)), make_pair(key[i], leaf));
+            return;
+        }
+        uint32_t child = nodes[n].kids[k].second;
+        const string& lab = nodes[child].label;
+        size_t j = 0;
+        while (j < lab.size() && i + j < key.size() && lab[j] == key[i + j]) ++j;
+        if (j < lab.size()) {
+            // key leaves the edge part way: split it
+            uint32_t mid = newNode(lab.substr(0, j));
+            nodes[child].label.erase(0, j);
+            nodes[mid].kids.push_back(make_pair(nodes[child].label[0], child));
+            nodes[n].kids[k].second = mid;
+            child = mid;
+        }
+        n = child;
+        i += j;
+    }
+    nodes[n].ids.push_back(id);
+}
+
+void PrefixTrie::erase(string_view key, uint32_t id) {
+    uint32_t parent = 0, n = 0;
+    size_t i = 0;
+    while (i < key.size()) {
+        int k = kidIndex(n, key[i]);
+        if (k < 0) return;
+        uint32_t child = nodes[n].kids[k].second;
+        const string& lab = nodes[child].label;
+        if (key.compare(i, lab.size(), lab) != 0) return;
+        parent = n;
+        n = child;
+        i += lab.size();
+    }
+    auto& ids = nodes[n].ids;
+    auto it = std::find(ids.begin(), ids.end(), id);
+    if (it == ids.end()) return;
+    ids.erase(it);
+    if (n == 0 || !ids.empty()) return;
+    // keep the tree compressed: drop empty leaves, fold pass-through nodes
+    if (nodes[n].kids.empty()) {
+        auto& kids = nodes[parent].kids;
+        kids.erase(kids.begin() + kidIndex(parent, nodes[n].label[0]));
+        freeNodes.push_back(n);
+        n = parent;
+        if (n == 0 || !nodes[n].ids.empty()) return;
+    }
+    if (nodes[n].kids.size() == 1) {
+        uint32_t only = nodes[n].kids[0].second;
+        nodes[n].label += nodes[only].label;
+        nodes[n].ids.swap(nodes[only].ids);
+        nodes[n].kids.swap(nodes[only].kids);
+        freeNodes.push_back(only);
+    }
+}
+
+void PrefixTrie::collect(uint32_t n, size_t limit, vector<uint32_t>& out) const {
+    for (uint32_t id : nodes[n].ids) {
+        if (out.size() >= limit) return;
+        out.push_back(id);
+    }
+    for (const auto& k : nodes[n].kids) {
+        if (out.size() >= limit) return;
+        collect(k.second, limit, out);
+    }
+}
+
+void PrefixTrie::find(string_view prefix, size_t limit, vector<uint32_t>& out) const {
+    uint32_t n = 0;
+    size_t i = 0;
+    while (i < prefix.size()) {
+        int k = kidIndex(n, prefix[i]);
+        if (k < 0) return;
+        uint32_t child = nodes[n].kids[k].second;
+        const string& lab = nodes[child].label;
+        size_t m = min(lab.size(), prefix.size() - i);
+        if (prefix.compare(i, m, lab, 0, m) != 0) return;
+        n = child;
+        i += m;
+    }
+    collect(n, limit, out);
+}
+
+// lookup keys: lowercase name, phone digits only
+string nameKey(string_view name) {
+    string k(name);
+    for (char& ch : k) ch = (char)tolower((unsigned char)ch);
+    return k;
+}
+string phoneKey(string_view phone) {
+    string k;
+    for (char ch : phone) if (ch >= '0' && ch <= '9') k += ch;
+    return k;
+}
+
+void ContactIndex::add(const Contact& c) {
+    string n = nameKey(c.name), p = phoneKey(c.phone);
+    if (!n.empty()) byName.insert(n, (uint32_t)c.seq);
+    if (!p.empty()) byPhone.insert(p, (uint32_t)c.seq);
+}
+
+void ContactIndex::remove(const Contact& c) {
+    string n = nameKey(c.name), p = phoneKey(c.phone);
+    if (!n.empty()) byName.erase(n, (uint32_t)c.seq);
+    if (!p.empty()) byPhone.erase(p, (uint32_t)c.seq);
+}
+
+// index all loaded contacts
+void buildContactIndex() {
+    contactIndex.clear();
+    for (size_t i = 0; i < contacts.size(); ++i) contactIndex.add(contacts[i]);
+}
+
+// --------------------- Task Schedule ---------------------
+void TaskSchedule::up(size_t i) {
+    Entry e = heap[i];
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!(e < heap[parent])) break;
+        put(i, heap[parent]);
+        i = parent;
+    }
+    put(i, e);
+}
+
+void TaskSchedule::down(size_t i) {
+    Entry e = heap[i];
+    size_t n = heap.size();
+    while (true) {
+        size_t kid = 2 * i + 1;
+        if (kid >= n) break;
+        if (kid + 1 < n && heap[kid + 1] < heap[kid]) ++kid;
+        if (!(heap[kid] < e)) break;
+        put(i, heap[kid]);
+        i = kid;
+    }
+    put(i, e);
+}
+
+void TaskSchedule::build(const RecordStore<Task>& s) {
+    clear();
+    for (size_t i = 0; i < s.size(); ++i)
+        if (s[i].due && !s.isDone(i)) heap.push_back(entryOf(s[i]));
+    slots.assign(s.log.adds, NONE);
+    for (const Entry& e : heap) if (e.seq >= slots.size()) slots.resize(e.seq + 1, NONE);
+    for (size_t i = heap.size() / 2; i-- > 0; ) down(i);
+    for (size_t i = 0; i < heap.size(); ++i) slots[heap[i].seq] = (uint32_t)i;
+}
+
+void TaskSchedule::set(const Task& t, bool done) {
+    if (!t.due || done) { remove(t.seq); return; }
+    Entry e = entryOf(t);
+    size_t i = slotOf(t.seq);
+    if (i == NONE) {
+        if (t.seq >= slots.size()) slots.resize(max<size_t>(t.seq + 1, slots.size() * 2), NONE);
+        heap.push_back(e);
+        up(heap.size() - 1);
+        return;
+    }
+    bool sooner = e < heap[i];
+    heap[i] = e;
+    if (sooner) up(i); else down(i);
+}
+
+void TaskSchedule::remove(uint32_t seq) {
+    size_t i = slotOf(seq);
+    if (i == NONE) return;
+    slots[seq] = NONE;
+    Entry last = heap.back();
+    heap.pop_back();
+    if (i == heap.size()) return;
+    put(i, last);
+    if (i > 0 && heap[i] < heap[(i - 1) / 2]) up(i); else down(i);
+}
+
+void TaskSchedule::next(size_t k, int64_t until, vector<uint32_t>& out) const {
+    out.clear();
+    // frontier: heap positions whose parents were taken, smallest on top
+    auto later = [&](uint32_t a, uint32_t b) { return heap[b] < heap[a]; };
+    vector<uint32_t> frontier;
+    if (!heap.empty()) frontier.push_back(0);
+    while (!frontier.empty() && out.size() < k) {
+        pop_heap(frontier.begin(), frontier.end(), later);
+        uint32_t i = frontier.back();
+        frontier.pop_back();
+        if (until != NO_TIME && int64_t(heap[i].due) * 60 >= until) break;
+        out.push_back(heap[i].seq);
+        for (size_t kid = 2 * (size_t)i + 1; kid <= 2 * (size_t)i + 2 && kid < heap.size(); ++kid) {
+            frontier.push_back((uint32_t)kid);
+            push_heap(frontier.begin(), frontier.end(), later);
+        }
+    }
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "record_store.h"
+
+// ------------------- Note Search Index -------------------
+// Inverted index over note content: lowercase token -> sorted seqs of
+// the notes containing it. Since notes are kept in seq order, a seq is
+// mapped back to a note by binary search. Deleted notes stay listed
+// until the index is saved; search skips them.
+class NoteIndex {
+public:
+    void clear() { postings.clear(); }
+    void add(size_t seq, string_view content);
+    // add back the notes (seq, content) undo brought back, merging each
+    // token's new seqs into its list in one pass
+    void restore(const vector<pair<uint32_t, string_view>>& back);
+    // drop deleted notes (alive[seq] is 0)
+    void prune(const vector<char>& alive);
+    // seqs of notes matching every word and "quoted phrase", newest first
+    vector<size_t> search(const string& query, size_t limit) const;
+    bool save(const string& path, uint64_t textSize, uint64_t adds) const;
+    bool load(const string& path, const string& textPath, uint64_t adds);
+private:
+    unordered_map<string, vector<uint32_t>> postings;
+};
+
+// ------------------- Contact Lookup Index ----------------
+// Path-compressed trie from key to record seqs. Every node other than
+// the root either ends a key or branches, so collecting a subtree
+// touches O(results) nodes and a lookup costs O(prefix + results).
+class PrefixTrie {
+public:
+    void clear() { nodes.assign(1, Node()); freeNodes.clear(); }
+    void insert(string_view key, uint32_t id);
+    void erase(string_view key, uint32_t id);
+    // ids of keys starting with prefix, in key order, at most limit
+    void find(string_view prefix, size_t limit, vector<uint32_t>& out) const;
+private:
+    struct Node {
+        string label;                       // edge text leading to this node
+        vector<pair<char, uint32_t>> kids;  // sorted by first label char
+        vector<uint32_t> ids;               // records whose key ends here
+    };
+    vector<Node> nodes = vector<Node>(1);
+    vector<uint32_t> freeNodes;
+    uint32_t newNode(string label);
+    int kidIndex(uint32_t n, char c) const;
+    void collect(uint32_t n, size_t limit, vector<uint32_t>& out) const;
+};
+
+// name (case-insensitive) and phone-digit lookup over contacts
+struct ContactIndex {
+    PrefixTrie byName, byPhone;
+    void clear() { byName.clear(); byPhone.clear(); }
+    void add(const Contact& c);
+    void remove(const Contact& c);
+};
+
+// --------------------- Task Schedule ---------------------
+// Open tasks that have a due date, in an indexed binary min-heap
+// ordered by due time, then priority (none last), then id. slots maps
+// a task id to its place in the heap, so adding, rescheduling or
+// dropping a task is O(log n), and the first k due are read in
+// O(k log k) by walking the heap best-first, without popping anything.
+class TaskSchedule {
+public:
+    void clear() { heap.clear(); slots.clear(); }
+    // the open tasks of s that have a due date, heapified in O(n)
+    void build(const RecordStore<Task>& s);
+    // place t by its due date and priority, or drop it (done, no due date)
+    void set(const Task& t, bool done);
+    void remove(uint32_t seq);
+    // ids of up to k tasks due before until (NO_TIME: any), soonest first
+    void next(size_t k, int64_t until, vector<uint32_t>& out) const;
+    size_t size() const { return heap.size(); }
+private:
+    struct Entry {
+        uint32_t due;
+        uint32_t seq;
+        uint8_t rank; // priority, with none (0) after low
+        bool operator<(const Entry& o) const {
+            if (due != o.due) return due < o.due;
+            if (rank != o.rank) return rank < o.rank;
+            return seq < o.seq;
+        }
+    };
+    static Entry entryOf(const Task& t) { return Entry{t.due, t.seq, uint8_t(t.priority ? t.priority : 4)}; }
+    vector<Entry> heap;
+    vector<uint32_t> slots; // task id -> heap position, NONE if not queued
+    static constexpr uint32_t NONE = UINT32_MAX;
+    void put(size_t i, const Entry& e) { heap[i] = e; slots[e.seq] = (uint32_t)i; }
+    uint32_t slotOf(uint32_t seq) const { return seq < slots.size() ? slots[seq] : NONE; }
+    void up(size_t i);
+    void down(size_t i);
+};
+
+// ------------------- Note Search Index -------------------
+// Load notes.idx or rebuild it from the loaded notes
+void openNoteIndex();
+// Write notes.idx unless already current
+void saveNoteIndex();
+
+// ------------------- Contact Lookup Index ----------------
+// Index all loaded contacts by name and phone
+void buildContactIndex();
+// Lookup keys: lowercase name, phone digits only
+string nameKey(string_view name);
+string phoneKey(string_view phone);
@@ -0,0 +1,337 @@
+#pragma once
+
+#include "arena.h"
+#include "bits.h"
+#include "files.h"
+#include "store_log.h"
+
+// -------------------- Date Range Index -------------------
+// (created, seq) pairs sorted by time, then seq. Records are normally
+// added in time order, so inserts land at the end; a range query is a
+// binary search plus one step per result. Deleted records are left in
+// until the next compaction prunes them; RecordStore::range skips them.
+class TimeIndex {
+public:
+    void clear() { entries.clear(); }
+    void add(int64_t created, size_t seq) {
+        pair<int64_t, size_t> e(created, seq);
+        entries.insert(upper_bound(entries.begin(), entries.end(), e), e);
+    }
+    // add back the records undo brought back (those not yet pruned are
+    // still here); a few are inserted, many merged in one pass
+    void restore(vector<pair<int64_t, size_t>>& back) {
+        sort(back.begin(), back.end());
+        if (back.size() <= 8) {
+            for (const auto& e : back) {
+                auto it = lower_bound(entries.begin(), entries.end(), e);
+                if (it == entries.end() || *it != e) entries.insert(it, e);
+            }
+            return;
+        }
+        vector<pair<int64_t, size_t>> merged;
+        merged.reserve(entries.size() + back.size());
+        set_union(entries.begin(), entries.end(), back.begin(), back.end(), back_inserter(merged));
+        entries.swap(merged);
+    }
+    // drop the entries of deleted records (alive[seq] is 0)
+    void prune(const vector<char>& alive) {
+        size_t w = 0;
+        for (auto& e : entries)
+            if (e.second < alive.size() && alive[e.second]) entries[w++] = e;
+        entries.resize(w);
+    }
+    // seqs of records created in [from, to], oldest first
+    void range(int64_t from, int64_t to, vector<size_t>& out) const {
+        auto it = lower_bound(entries.begin(), entries.end(), make_pair(from, size_t(0)));
+        for (; it != entries.end() && it->first <= to; ++it) out.push_back(it->second);
+    }
+    template <typename T>
+    void build(const vector<T>& items) {
+        entries.clear();
+        entries.reserve(items.size());
+        for (const T& r : items) entries.emplace_back(r.created, r.seq);
+        if (!is_sorted(entries.begin(), entries.end())) sort(entries.begin(), entries.end());
+    }
+private:
+    vector<pair<int64_t, size_t>> entries;
+};
+
+// ---------------------- Undo History ---------------------
+// Undo / redo for one store, at most undoDepth steps (--undo-depth).
+// A step changes which ids are live and, for tasks, which are done;
+// both are PersistentBits, so a step holds the versions before and
+// after it for O(log n) extra memory per record it touched. Due date
+// and priority changes ride along as edits. Undoing a step appends the
+// ops that turn the store back into the version before it ("#RES n"
+// brings back a deleted record), so the log stays the only truth.
+// Deleted records a step can bring back are kept as dead slots by
+// vacuum() and written (then deleted again) by compaction.
+struct StoreHistory {
+    struct Version { PersistentBits live, done; };
+    struct Edit {
+        uint32_t seq, dueBefore, dueAfter;
+        uint8_t priorityBefore, priorityAfter;
+    };
+    struct Step {
+        string label;
+        Version before, after;
+        vector<Edit> edits;
+    };
+    bool tracking = false; // now follows every change to the store
+    Version now;
+    Version saved;         // now, as of the last step recorded
+    vector<Edit> edits;    // made since then
+    deque<Step> undo, redo;
+    void clear() {
+        tracking = false;
+        now = saved = Version();
+        edits.clear();
+        undo.clear();
+        redo.clear();
+    }
+    // ids live in some version a step leads to, or in the one the next
+    // step will start from
+    PersistentBits kept() const {
+        PersistentBits k = saved.live;
+        for (const deque<Step>* d : {&undo, &redo})
+            for (const Step& s : *d) k = PersistentBits::unite(PersistentBits::unite(k, s.before.live), s.after.live);
+        return k;
+    }
+};
+
+// --------------------- Record Store ----------------------
+// Growable record list plus the arena that owns its strings and one
+// done bit per record (only ever set for tasks). No fixed capacity:
+// grows geometrically, so loading n records is O(n).
+// Records sit in slots in seq order. Erasing only marks the slot dead
+// and updates the rank tree, O(log n); positions (what the menus
+// number) are ranks among the live slots. vacuum() drops dead slots
+// (except those undo can still bring back) and runs with each
+// compaction. While history.tracking, every change is mirrored in
+// history.now.
+template <typename T>
+struct RecordStore {
+    vector<T> items;                      // slots, dead ones included
+    StringArena text;
+    BitVector done;
+    BitVector dead;                       // erased slots
+    RankTree live;                        // live slot counts
+    size_t deadSlots = 0;
+    vector<string_view> oddDates = vector<string_view>(1); // date texts that do not parse
+    StoreLog log;
+    TimeIndex byTime;                     // records by creation time
+    vector<unique_ptr<MappedFile>> files; // loaded images records point into
+    bool loaded = false;                  // set once loading has started
+    thread loader;                        // background load after login
+    StoreHistory history;                 // undo / redo steps
+
+    size_t size() const { return items.size() - deadSlots; }
+    bool empty() const { return size() == 0; }
+    // slot of the record at position i
+    size_t slot(size_t i) const { return deadSlots ? live.select(i) : i; }
+    T& operator[](size_t i) { return items[slot(i)]; }
+    const T& operator[](size_t i) const { return items[slot(i)]; }
+    bool isDone(size_t i) const { return done.test(slot(i)); }
+    void flipDone(size_t i) {
+        size_t k = slot(i);
+        done.flip(k);
+        if (history.tracking) history.now.done = history.now.done.with(items[k].seq, done.test(k));
+    }
+    size_t doneCount() const { return done.count(); }
+    // copy a string into this store's arena
+    string_view keep(string_view s) { return text.keep(s); }
+    // a record's date text; formatted ones stay valid until the next
+    // call on the same thread
+    string_view dateOf(const T& r) const { return recordDate(r, oddDates); }
+    void reserve(size_t n) {
+        items.reserve(n);
+        done.reserve(n);
+        dead.reserve(n);
+        live.reserve(n);
+    }
+    void add(const T& r, bool isDone = false) {
+        items.push_back(r);
+        done.push_back(isDone);
+        dead.push_back(false);
+        live.push_back(1);
+        if (history.tracking) {
+            history.now.live = history.now.live.with(r.seq, true);
+            if (isDone) history.now.done = history.now.done.with(r.seq, true);
+        }
+    }
+    void erase(size_t i) {
+        size_t k = slot(i);
+        if (history.tracking) {
+            history.now.live = history.now.live.with(items[k].seq, false);
+            if (done.test(k)) history.now.done = history.now.done.with(items[k].seq, false);
+        }
+        eraseSlot(k);
+    }
+    // erase every record for which drop(record, done) is true in one
+    // pass over the slots; gone(record) is called for each
+    template <typename P, typename G>
+    size_t eraseIf(P drop, G gone) {
+        size_t n = 0;
+        vector<uint32_t> seqs, doneSeqs; // for history, in seq order
+        for (size_t k = 0; k < items.size(); ++k) {
+            if (dead.test(k) || !drop(items[k], done.test(k))) continue;
+            gone(items[k]);
+            if (history.tracking) {
+                seqs.push_back(items[k].seq);
+                if (done.test(k)) doneSeqs.push_back(items[k].seq);
+            }
+            eraseSlot(k);
+            ++n;
+        }
+        if (!seqs.empty()) {
+            history.now.live = history.now.live.without(seqs);
+            history.now.done = history.now.done.without(doneSeqs);
+        }
+        return n;
+    }
+    // slot of the record with this seq, dead or not; SIZE_MAX if gone
+    size_t slotOfSeq(size_t seq) const {
+        auto it = lower_bound(items.begin(), items.end(), seq, [](const T& r, size_t s) { return r.seq < s; });
+        return it == items.end() || it->seq != seq ? SIZE_MAX : size_t(it - items.begin());
+    }
+    // bring back the erased record in slot k (not done)
+    void revive(size_t k) {
+        dead.set(k, false);
+        live.add(k, 1);
+        --deadSlots;
+        if (history.tracking) history.now.live = history.now.live.with(items[k].seq, true);
+    }
+    // start mirroring changes in history.now
+    void trackHistory() {
+        vector<uint64_t> alive((log.adds + 63) / 64), doneWords(alive.size());
+        if (items.size() == log.adds && dead.size() == items.size() && done.size() == items.size()) {
+            // no ids skipped: slot k holds seq k, so the bit vectors are the sets
+            doneWords = done.bits();
+            for (size_t w = 0; w < alive.size(); ++w) alive[w] = ~dead.bits()[w];
+            if (log.adds & 63) alive.back() &= (uint64_t(1) << (log.adds & 63)) - 1;
+        } else {
+            for (size_t k = 0; k < items.size(); ++k) {
+                uint32_t q = items[k].seq;
+                if (q >= log.adds || dead.test(k)) continue;
+                alive[q >> 6] |= uint64_t(1) << (q & 63);
+                if (done.test(k)) doneWords[q >> 6] |= uint64_t(1) << (q & 63);
+            }
+        }
+        history.now.live = PersistentBits::fromWords(alive);
+        history.now.done = PersistentBits::fromWords(doneWords);
+        history.tracking = true;
+    }
+    // true if a dead slot is being kept for undo
+    bool keepsDead() const {
+        if (!deadSlots) return false;
+        PersistentBits keep = history.kept();
+        for (size_t k = 0; k < items.size(); ++k)
+            if (dead.test(k) && keep.test(items[k].seq)) return true;
+        return false;
+    }
+    // position of the record with this seq (slots stay in seq order), SIZE_MAX if gone
+    size_t indexOfSeq(size_t seq) const {
+        auto it = lower_bound(items.begin(), items.end(), seq, [](const T& r, size_t s) { return r.seq < s; });
+        if (it == items.end() || it->seq != seq) return SIZE_MAX;
+        size_t k = size_t(it - items.begin());
+        if (!deadSlots) return k;
+        return dead.test(k) ? SIZE_MAX : live.rank(k);
+    }
+    // seqs of live records created in [from, to], oldest first
+    void range(int64_t from, int64_t to, vector<size_t>& out) const {
+        byTime.range(from, to, out);
+        if (deadSlots)
+            out.erase(remove_if(out.begin(), out.end(), [this](size_t q) { return indexOfSeq(q) == SIZE_MAX; }),
+                      out.end());
+    }
+    // drop dead slots, keeping those undo can bring back; positions do
+    // not change
+    void vacuum() {
+        if (!deadSlots) return;
+        PersistentBits keep = history.kept();
+        vector<size_t> kept;
+        size_t w = 0;
+        for (size_t k = 0; k < items.size(); ++k) {
+            if (dead.test(k)) {
+                if (!keep.test(items[k].seq)) continue;
+                kept.push_back(w);
+            }
+            done.set(w, done.test(k));
+            items[w++] = items[k];
+        }
+        items.resize(w);
+        done.resize(w);
+        dead.clear();
+        dead.resize(w);
+        live.fill(w);
+        for (size_t k : kept) { dead.set(k, true); live.add(k, -1); }
+        deadSlots = kept.size();
+    }
+    // seq -> 1 for each live record, 0 for ids that are gone
+    vector<char> liveSeqs() const {
+        vector<char> alive(log.adds, 0);
+        for (size_t k = 0; k < items.size(); ++k)
+            if (!dead.test(k) && items[k].seq < alive.size()) alive[items[k].seq] = 1;
+        return alive;
+    }
+    // drops the records alone
+    void clearRecords() {
+        items.clear(); items.shrink_to_fit();
+        done.clear(); dead.clear(); live.clear();
+        deadSlots = 0;
+    }
+    // drops records and their text in one go
+    void clear() {
+        clearRecords();
+        text.clear(); oddDates.assign(1, string_view()); byTime.clear(); files.clear();
+        history.clear();
+    }
+    // map a data file for loading; empty view if it does not exist
+    string_view map(const string& path) {
+        unique_ptr<MappedFile> f(new MappedFile());
+        if (!f->open(path)) return string_view();
+        files.push_back(move(f));
+        return files.back()->view();
+    }
+private:
+    void eraseSlot(size_t k) {
+        dead.set(k, true);
+        done.set(k, false);
+        live.add(k, -1);
+        ++deadSlots;
+    }
+};
+
+// -------------------- Parsed Chunk ----------------------
+// An op line seen while parsing, with the number of adds before it in
+// its chunk (an op may only refer to records added earlier)
+struct LogOpRef {
+    char op;
+    size_t seq;
+    size_t addsBefore;
+    uint32_t due = 0;     // #DUE only
+    uint8_t priority = 0;
+};
+
+// Set a record's date from its text and parsed time; text that does
+// not parse is kept in oddDates and must outlive the record
+template <typename T>
+void setDate(T& r, vector<string_view>& oddDates, string_view text, int64_t created) {
+    r.created = created;
+    r.oddDate = 0;
+    if (created == NO_TIME && !text.empty()) {
+        r.oddDate = (uint32_t)oddDates.size();
+        oddDates.push_back(text);
+    }
+}
+
+// Result of parsing one piece of a log file
+template <typename T>
+struct ParsedChunk {
+    vector<T> records;
+    vector<LogOpRef> ops;  // replayed once all pieces are merged
+    StringArena text;      // copies made while parsing (CRLF note bodies)
+    vector<string_view> oddDates = vector<string_view>(1); // until merged
+    BitVector done;        // done flags of the records (tasks only)
+    bool clean = true;     // false if a record ran past the end of the piece
+};
@@ -0,0 +1,348 @@
+#pragma once
+
+#include "codec.h"
+#include "record_store.h"
+
+// -------------------- Record Schema ---------------------
+// Each record type lists its fields once, in Schema<T>. The text log
+// formatter and parser, the snapshot string fields and the exports are
+// generated from that list (see Record Text Format), so a field or a
+// format change is made in one place.
+enum class FieldKind : uint8_t {
+    Text,     // one-line string
+    Body,     // multi-line string, ended by a "~" line (blocks only)
+    Date,     // the record's date (created / oddDate)
+    Done,     // the store's done flag (lines only)
+    Due,      // due minutes, 0 if none; left out when unset
+    Priority  // 1-3, 0 if none; left out when unset
+};
+
+// One field of T: how the log labels it, what exports call it and
+// where T keeps it (Date and Done are kept by the store)
+template <typename T, FieldKind K, typename M = string_view>
+struct Field {
+    static constexpr FieldKind kind = K;
+    string_view label;       // "LABEL: value" in blocks, " | <label>value" in a line
+    string_view name;        // JSONL key and CSV column
+    M T::*member = nullptr;
+};
+template <typename F> constexpr FieldKind kindOf = decay_t<F>::kind;
+
+// Blocks: a "LABEL: value" line per field, then "---"; the first label
+// starts a record. Line: "[d] text", each tagged field that is set and
+// " | date" on one line, opened by "[d]+n " instead when n tags are set.
+enum class RecordLayout : uint8_t { Blocks, Line };
+
+template <typename T> struct Schema;
+
+template <> struct Schema<Note> {
+    static constexpr RecordLayout layout = RecordLayout::Blocks;
+    static constexpr auto fields = make_tuple(
+        Field<Note, FieldKind::Date>{"DATE", "date"},
+        Field<Note, FieldKind::Body>{"CONTENT", "content", &Note::content});
+};
+
+template <> struct Schema<Task> {
+    static constexpr RecordLayout layout = RecordLayout::Line;
+    static constexpr auto fields = make_tuple(
+        Field<Task, FieldKind::Done>{"", "done"},
+        Field<Task, FieldKind::Text>{"", "text", &Task::text},
+        Field<Task, FieldKind::Date>{"", "date"},
+        Field<Task, FieldKind::Due, uint32_t>{"due ", "due", &Task::due},
+        Field<Task, FieldKind::Priority, uint8_t>{"p", "priority", &Task::priority});
+};
+
+template <> struct Schema<Contact> {
+    static constexpr RecordLayout layout = RecordLayout::Blocks;
+    static constexpr auto fields = make_tuple(
+        Field<Contact, FieldKind::Text>{"NAME", "name", &Contact::name},
+        Field<Contact, FieldKind::Text>{"PHONE", "phone", &Contact::phone},
+        Field<Contact, FieldKind::Date>{"DATE", "date"});
+};
+
+// call f on each field of T, in schema order
+template <typename T, typename F>
+constexpr void forEachField(F&& f) {
+    apply([&](const auto&... field) { (f(field), ...); }, Schema<T>::fields);
+}
+// the same, stopping at the first f that returns false; false if one did
+template <typename T, typename F>
+constexpr bool allFields(F&& f) {
+    return apply([&](const auto&... field) { return (f(field) && ...); }, Schema<T>::fields);
+}
+// number of fields of T of kind k
+template <typename T>
+constexpr int fieldCount(FieldKind k) {
+    return apply([k](const auto&... field) { return (0 + ... + int(kindOf<decltype(field)> == k)); },
+                 Schema<T>::fields);
+}
+
+// a string field's text (a note's content may still be packed)
+template <typename T>
+inline string_view fieldText(const T& r, string_view T::*m) { return r.*m; }
+inline string_view fieldText(const Note& n, string_view Note::*) { return noteText(n); }
+
+//-------- Record Text Format ---------
+// The log formatter and parser for every store, generated from its
+// Schema<T>. Parsed fields are views into the file image; only a body
+// with CR line endings (or no final newline) is copied.
+
+// line starts with "LABEL:"
+inline bool hasLabel(string_view line, string_view label) {
+    return line.size() > label.size() && line[label.size()] == ':'
+        && line.compare(0, label.size(), label) == 0;
+}
+
+// strip "KEY:" and one following space
+inline string_view fieldValue(string_view line, size_t keyLen) {
+    line.remove_prefix(keyLen);
+    if (!line.empty() && line[0] == ' ') line.remove_prefix(1);
+    return line;
+}
+
+// "#DUE n dd/mm/yyyy hh:mm pN" or "#DUE n - pN"
+inline bool parseDueOp(string_view line, LogOpRef& o) {
+    if (line.size() < 11 || line.compare(0, 5, "#DUE ") != 0) return false;
+    size_t sp = line.find(' ', 5);
+    if (sp == string_view::npos || sp == 5 || line.size() - sp < 5) return false;
+    o.op = 'U';
+    o.seq = 0;
+    for (size_t i = 5; i < sp; ++i) {
+        if (line[i] < '0' || line[i] > '9') return false;
+        o.seq = o.seq * 10 + (line[i] - '0');
+    }
+    string_view p = line.substr(line.size() - 3), when = line.substr(sp + 1, line.size() - sp - 4);
+    if (p[0] != ' ' || p[1] != 'p' || p[2] < '0' || p[2] > '3') return false;
+    o.priority = uint8_t(p[2] - '0');
+    int64_t t;
+    if (when == "-") o.due = 0;
+    else if (!parseDateTime(when, t) || !dueMinutes(t, o.due) || !o.due) return false;
+    return true;
+}
+
+// Fixed text of a record, joined from the schema at compile time (a
+// label too long to fit fails to compile)
+struct GlueText {
+    char text[24] = {};
+    size_t size = 0;
+    constexpr void add(string_view s) { for (char ch : s) text[size++] = ch; }
+    constexpr operator string_view() const { return string_view(text, size); }
+};
+// before[k] goes in front of field k's value ("\nPHONE: ", " | due "),
+// end after a block's last one
+template <typename T>
+struct RecordGlue {
+    GlueText before[tuple_size_v<decay_t<decltype(Schema<T>::fields)>>];
+    GlueText end;
+};
+template <typename T>
+constexpr RecordGlue<T> makeGlue() {
+    RecordGlue<T> glue;
+    size_t k = 0;
+    string_view pending; // what ends the previous field
+    forEachField<T>([&](const auto& field) {
+        constexpr FieldKind K = kindOf<decltype(field)>;
+        GlueText& b = glue.before[k++];
+        if (Schema<T>::layout == RecordLayout::Line) {
+            b.add(" | ");
+            b.add(field.label);
+            return;
+        }
+        b.add(pending);
+        b.add(field.label);
+        b.add(K == FieldKind::Body ? ":\n" : ": ");
+        pending = K == FieldKind::Body ? "~\n" : "\n";
+    });
+    glue.end.add(pending);
+    glue.end.add("---\n");
+    return glue;
+}
+template <typename T> constexpr RecordGlue<T> recordGlue = makeGlue<T>();
+
+template <typename T>
+void formatRecord(string& out, const T& r, bool done, string_view date) {
+    constexpr const RecordGlue<T>& glue = recordGlue<T>;
+    size_t k = 0;
+    if constexpr (Schema<T>::layout == RecordLayout::Blocks) {
+        forEachField<T>([&](const auto& field) {
+            out += glue.before[k++];
+            if constexpr (kindOf<decltype(field)> == FieldKind::Date) out += date;
+            else out += fieldText(r, field.member);
+        });
+        out += glue.end;
+    } else {
+        // "[d] " ("[d]+n " with n tags set), the text, each tagged
+        // field that is set, the date last
+        int tags = 0;
+        forEachField<T>([&](const auto& field) {
+            constexpr FieldKind K = kindOf<decltype(field)>;
+            if constexpr (K == FieldKind::Due || K == FieldKind::Priority) tags += r.*field.member != 0;
+        });
+        out += done ? "[1]" : "[0]";
+        if (tags) { out += '+'; out += char('0' + tags); }
+        out += ' ';
+        forEachField<T>([&](const auto& field) {
+            constexpr FieldKind K = kindOf<decltype(field)>;
+            string_view before = glue.before[k++];
+            if constexpr (K == FieldKind::Text) {
+                out += r.*field.member;
+            } else if constexpr (K == FieldKind::Due || K == FieldKind::Priority) {
+                if (!(r.*field.member)) return;
+                out += before;
+                if constexpr (K == FieldKind::Due) out += dueDates.format(int64_t(r.*field.member) * 60);
+                else out += char('0' + r.*field.member);
+            }
+        });
+        out += " | ";
+        out += date;
+        out += '\n';
+    }
+}
+
+// Take the n tagged fields of a line off the end of its text into r,
+// as formatRecord wrote them; false (r and text left alone) if the
+// text does not end in n distinct tags
+template <typename T>
+bool takeTaggedFields(T& r, string_view& text, int n) {
+    static_assert(fieldCount<T>(FieldKind::Due) + fieldCount<T>(FieldKind::Priority) <= 9,
+                  "\"[d]+n\" counts the tags in one digit");
+    T tagged{};
+    string_view rest = text;
+    for (int k = 0; k < n; ++k) {
+        size_t bar = rest.rfind(" | ");
+        if (bar == string_view::npos) return false;
+        string_view f = rest.substr(bar + 3);
+        bool taken = !allFields<T>([&](const auto& field) {
+            constexpr FieldKind K = kindOf<decltype(field)>;
+            if constexpr (K == FieldKind::Due || K == FieldKind::Priority) {
+                if (tagged.*field.member || f.compare(0, field.label.size(), field.label) != 0) return true;
+                string_view v = f.substr(field.label.size());
+                if constexpr (K == FieldKind::Priority) {
+                    if (v.size() != 1 || v[0] < '1' || v[0] > '3') return true;
+                    tagged.*field.member = uint8_t(v[0] - '0');
+                } else {
+                    int64_t t;
+                    uint32_t m;
+                    if (v.size() != 16 || !parseDateTime(v, t) || !dueMinutes(t, m)) return true;
+                    tagged.*field.member = m;
+                }
+                return false; // taken
+            }
+            return true;
+        });
+        if (!taken) return false;
+        rest = rest.substr(0, bar);
+    }
+    forEachField<T>([&](const auto& field) {
+        constexpr FieldKind K = kindOf<decltype(field)>;
+        if constexpr (K == FieldKind::Due || K == FieldKind::Priority) r.*field.member = tagged.*field.member;
+    });
+    text = rest;
+    return true;
+}
+
+// The lines of a body up to its "~" line, which is consumed
+template <typename T>
+inline string_view readBody(LineReader& in, ParsedChunk<T>& out, string& copy) {
+    string_view line;
+    size_t start = in.pos, end;
+    while (true) {
+        end = in.pos;
+        if (!in.next(line)) { end = in.buf.size(); out.clean = false; break; }
+        if (line == "~") break;
+    }
+    string_view body = start < end ? in.buf.substr(start, end - start) : string_view();
+    if (body.find('\r') == string_view::npos && (body.empty() || body.back() == '\n'))
+        return body; // zero-copy
+    copy.clear();
+    LineReader sub(body);
+    while (sub.next(line)) { copy += line; copy += '\n'; }
+    return out.text.keep(copy);
+}
+
+// Read the record that starts at line; false if a block ended before
+// its body, which ends the piece
+template <typename T>
+inline bool readRecord(LineReader& in, string_view line, ParsedChunk<T>& out, DateCache& dates, string& copy) {
+    T r{};
+    string_view date;
+    if constexpr (Schema<T>::layout == RecordLayout::Line) {
+        static_assert(fieldCount<T>(FieldKind::Text) == 1 && fieldCount<T>(FieldKind::Body) == 0,
+                      "a line holds one text field");
+        // text starts after "] " (or "]"), or after "]+n " on a line
+        // with n tags: only those lines are read for tags. Without a
+        // " | " there is no date.
+        int tags = 0;
+        size_t start = 3;
+        if (line.size() > 4 && line[3] == '+' && line[4] >= '1' && line[4] <= '9') {
+            tags = line[4] - '0';
+            start = 5;
+        }
+        if (line.size() > start && line[start] == ' ') ++start;
+        string_view text = line.substr(start);
+        size_t bar = text.rfind(" | ");
+        if (bar != string_view::npos) {
+            date = text.substr(bar + 3);
+            text = text.substr(0, bar);
+            if (tags) takeTaggedFields(r, text, tags);
+        }
+        forEachField<T>([&](const auto& field) {
+            if constexpr (kindOf<decltype(field)> == FieldKind::Text) r.*field.member = text;
+        });
+        out.done.push_back(line[1] == '1');
+    } else {
+        static_assert(fieldCount<T>(FieldKind::Done) + fieldCount<T>(FieldKind::Due)
+                      + fieldCount<T>(FieldKind::Priority) == 0, "blocks hold text, body and date fields");
+        static_assert(kindOf<decltype(get<0>(Schema<T>::fields))> != FieldKind::Body,
+                      "a block starts with a one-line field");
+        bool whole = allFields<T>([&](const auto& field) {
+            constexpr FieldKind K = kindOf<decltype(field)>;
+            // the first field's line is already read
+            const bool first = (const void*)&field == (const void*)&get<0>(Schema<T>::fields);
+            if constexpr (K == FieldKind::Body) {
+                if (!in.next(line)) { out.clean = false; return false; } // "LABEL:"
+                r.*field.member = readBody(in, out, copy);
+            } else {
+                // a missing label leaves the field empty
+                string_view v;
+                if (first) v = fieldValue(line, field.label.size() + 1);
+                else if (!in.next(line)) out.clean = false;
+                else if (hasLabel(line, field.label)) v = fieldValue(line, field.label.size() + 1);
+                if constexpr (K == FieldKind::Date) date = v;
+                else r.*field.member = v;
+            }
+            return true;
+        });
+        if (!whole) return false;
+        // consume separator (---) if present
+        if (!in.next(line)) out.clean = false;
+    }
+    setDate(r, out.oddDates, date, dates.get(date));
+    out.records.push_back(r);
+    return true;
+}
+
+template <typename T>
+void parseRecords(string_view region, ParsedChunk<T>& out) {
+    LineReader in(region);
+    string_view line;
+    string copy; // only used for copied bodies
+    DateCache dates;
+    char op; size_t seq;
+    LogOpRef due{};
+    while (in.next(line)) {
+        bool starts;
+        if constexpr (Schema<T>::layout == RecordLayout::Line)
+            starts = line.size() >= 3 && line[0] == '[' && (line[1] == '0' || line[1] == '1') && line[2] == ']';
+        else
+            starts = hasLabel(line, get<0>(Schema<T>::fields).label);
+        if (starts) {
+            if (!readRecord(in, line, out, dates, copy)) break;
+        } else if (parseLogOp(line, op, seq)) {
+            out.ops.push_back({op, seq, out.records.size()});
+        } else if (fieldCount<T>(FieldKind::Due) > 0 && parseDueOp(line, due)) {
+            due.addsBefore = out.records.size();
+            out.ops.push_back(due);
+        }
+    }
+}
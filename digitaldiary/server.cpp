@@ -0,0 +1,480 @@
+#include "server.h"
+#include "batch.h"
+#include "snapshot.h"
+#include "stores.h"
+#include "terminal.h"
+#include "users.h"
+
+// ----------------------- Server -------------------------
+// diary --user NAME --serve [SOCKET]     (POSIX only)
+// Keeps NAME's stores in memory and serves the batch commands to local
+// clients over a UNIX domain socket, by default diary.sock in the
+// user's shard. A request is one command line; the reply is the rows
+// batch mode would print, then a line "OK" or "ERR".
+// Reads run on the client's own thread under a shared lock. Writes go
+// to a single committer thread, which applies everything queued so far
+// under the exclusive lock (compacting there when due) and writes the
+// logs after releasing it, so a read waits at most for an in-memory
+// apply, never for the disk. An import reads and parses its file on the
+// client's thread and queues the records IMPORT_CHUNK at a time.
+// SIGINT / SIGTERM stop the daemon cleanly.
+// diary --user NAME --connect [SOCKET] sends stdin to a daemon, and an
+// interactive login whose shard is being served uses its menus instead
+// of opening the files; so does a batch run. The daemon holds the
+// shard lock exclusively, so nothing else can open the files beside
+// it, and it will not start while they are open. Both ends need NAME's
+// key (see authenticate);
+// the socket is private to the OS user running the daemon, and each
+// end checks that the other runs as that same user.
+#ifndef _WIN32
+
+const size_t SERVER_MAX_LINE = 16 << 20; // longest request accepted
+
+static shared_mutex storeLock;
+
+// a write waiting for the committer: a command line, or a chunk of
+// parsed import records to store
+struct WriteRequest {
+    string line;
+    const function<void()>* store = nullptr;
+    string reply;
+    bool ok = false;
+    bool done = false;
+};
+
+static mutex commitMutex;
+static condition_variable commitWake, commitDone;
+static deque<WriteRequest*> commitQueue;
+static bool commitStop = false;
+
+static mutex clientsMutex;
+static condition_variable clientsDone;
+static vector<int> clientFds;
+static volatile sig_atomic_t serverSignal = 0;
+
+static void serverOnSignal(int) { serverSignal = 1; }
+
+static bool sendAll(int fd, const string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        sent += (size_t)n;
+    }
+    return true;
+}
+
+// Reads '\n'-terminated lines from a socket
+class SocketLines {
+public:
+    explicit SocketLines(int fd = -1) : fd(fd) {}
+    bool next(string& line) {
+        while (true) {
+            size_t nl = buf.find('\n', pos);
+            if (nl != string::npos) {
+                line.assign(buf, pos, nl - pos);
+                pos = nl + 1;
+                return true;
+            }
+            if (buf.size() - pos > SERVER_MAX_LINE) return false;
+            buf.erase(0, pos);
+            pos = 0;
+            char chunk[64 << 10];
+            ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            buf.append(chunk, (size_t)n);
+        }
+    }
+private:
+    int fd;
+    string buf;
+    size_t pos = 0;
+};
+
+static bool unixAddress(const string& path, sockaddr_un& addr) {
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) return false;
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+// true if the process at the other end of fd runs as our own user
+static bool peerIsUs(int fd) {
+    uid_t uid;
+#ifdef SO_PEERCRED
+    ucred cred;
+    socklen_t len = sizeof(cred);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0) return false;
+    uid = cred.uid;
+#else
+    gid_t gid;
+    if (getpeereid(fd, &uid, &gid) != 0) return false;
+#endif
+    return uid == geteuid();
+}
+
+// connected socket for path, or -1
+static int connectSocket(const string& path) {
+    sockaddr_un addr;
+    if (!unixAddress(path, addr)) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) { ::close(fd); return -1; }
+    return fd;
+}
+
+// apply queued writes in groups until stopped and drained
+static void committerLoop() {
+    unique_lock<mutex> lk(commitMutex);
+    while (true) {
+        commitWake.wait(lk, []() { return !commitQueue.empty() || commitStop; });
+        if (commitQueue.empty()) return;
+        deque<WriteRequest*> group;
+        group.swap(commitQueue);
+        lk.unlock();
+        {
+            unique_lock<shared_mutex> w(storeLock);
+            for (StoreLog* log : storeLogs) logHold(*log);
+            size_t errors = 0;
+            for (WriteRequest* r : group) {
+                if (r->store) { (*r->store)(); r->ok = true; }
+                else r->ok = batchRun(r->line, r->reply, errors, false);
+            }
+            if (needsCompaction(notes)) rewriteNotesFile();
+            if (needsCompaction(tasks)) rewriteTasksFile();
+            if (needsCompaction(contacts)) rewriteContactsFile();
+        }
+        for (StoreLog* log : storeLogs) logCommit(*log);
+        lk.lock();
+        for (WriteRequest* r : group) r->done = true;
+        commitDone.notify_all();
+    }
+}
+
+// hand r to the committer and wait until it is applied
+static void queueWrite(WriteRequest& r) {
+    unique_lock<mutex> lk(commitMutex);
+    commitQueue.push_back(&r);
+    commitWake.notify_one();
+    commitDone.wait(lk, [&]() { return r.done; });
+}
+
+static void serveClient(int fd) {
+    SocketLines in(fd);
+    string line, out;
+    while (in.next(line)) {
+        out.clear();
+        bool ok;
+        if (batchIsImport(line)) {
+            STAT_TIME(STAT_SERVE_WRITE);
+            size_t errors = 0;
+            ok = batchImport(line, out, errors, [](const function<void()>& store) {
+                WriteRequest r;
+                r.store = &store;
+                queueWrite(r);
+            });
+        } else if (batchIsWrite(line)) {
+            STAT_TIME(STAT_SERVE_WRITE);
+            WriteRequest r;
+            r.line = line;
+            queueWrite(r);
+            out.swap(r.reply);
+            ok = r.ok;
+        } else {
+            STAT_TIME(STAT_SERVE_READ);
+            shared_lock<shared_mutex> r(storeLock);
+            size_t errors = 0;
+            ok = batchRun(line, out, errors, false);
+        }
+        out += ok ? "OK\n" : "ERR\n";
+        if (!sendAll(fd, out)) break;
+    }
+    lock_guard<mutex> g(clientsMutex);
+    clientFds.erase(find(clientFds.begin(), clientFds.end(), fd));
+    ::close(fd);
+    clientsDone.notify_all();
+}
+
+int runServer(const string& user, const string& path, const string& keyFile) {
+    if (!authenticate(user, keyFile)) return 1;
+    openUserShard(user);
+    if (!lockShard(true)) {
+        cerr << "The diary of " << user << " is open elsewhere (another daemon, a batch run or a login)\n";
+        return 1;
+    }
+    string sock = path.empty() ? SERVER_SOCKET : path;
+    sockaddr_un addr;
+    if (!unixAddress(sock, addr)) { cerr << "Socket path too long: " << sock << "\n"; return 1; }
+    int probe = connectSocket(sock);
+    if (probe >= 0) { ::close(probe); cerr << "A daemon is already serving " << sock << "\n"; return 1; }
+    unlink(sock.c_str()); // left behind by a daemon that did not stop cleanly
+    // owner-only from the moment it exists (no other threads run yet)
+    int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    mode_t mask = umask(0177);
+    bool bound = listenFd >= 0 && bind(listenFd, (sockaddr*)&addr, sizeof(addr)) == 0;
+    umask(mask);
+    if (!bound || chmod(sock.c_str(), 0600) != 0 || listen(listenFd, 64) != 0) {
+        cerr << "Cannot listen on " << sock << ": " << strerror(errno) << "\n";
+        if (listenFd >= 0) ::close(listenFd);
+        if (bound) unlink(sock.c_str());
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, serverOnSignal);
+    signal(SIGTERM, serverOnSignal);
+
+    startLoading();
+    waitNotes();
+    waitTasks();
+    waitContacts();
+    thread committer(committerLoop);
+    cerr << "Serving " << user << " on " << sock << "\n";
+
+    while (!serverSignal) {
+        pollfd p = {listenFd, POLLIN, 0};
+        if (poll(&p, 1, 200) <= 0) continue;
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0) continue;
+        if (!peerIsUs(fd)) {
+            ::close(fd);
+            cerr << "Refused a client running as another user\n";
+            continue;
+        }
+        lock_guard<mutex> g(clientsMutex);
+        clientFds.push_back(fd);
+        thread(serveClient, fd).detach();
+    }
+
+    // stop taking clients, end the open connections, then drain writes
+    ::close(listenFd);
+    unlink(sock.c_str());
+    {
+        unique_lock<mutex> lk(clientsMutex);
+        for (int fd : clientFds) shutdown(fd, SHUT_RDWR);
+        clientsDone.wait(lk, []() { return clientFds.empty(); });
+    }
+    {
+        lock_guard<mutex> g(commitMutex);
+        commitStop = true;
+    }
+    commitWake.notify_all();
+    committer.join();
+    closeLogs();
+    saveSnapshots();
+    saveUndoHistories();
+    saveNoteIndex();
+    dumpStats();
+    return 0;
+}
+
+// One connection to a daemon
+class DiaryClient {
+public:
+    DiaryClient() {}
+    DiaryClient(const DiaryClient&) = delete;
+    DiaryClient& operator=(const DiaryClient&) = delete;
+    ~DiaryClient() { if (fd >= 0) ::close(fd); }
+    // false unless a daemon of our own user answers at path
+    bool connect(const string& path) {
+        fd = connectSocket(path);
+        if (fd >= 0 && !peerIsUs(fd)) { ::close(fd); fd = -1; }
+        in = SocketLines(fd);
+        return fd >= 0;
+    }
+    // send one command; rows get the reply lines before the status
+    // line. false if the connection is gone
+    bool request(string_view line, vector<string>& rows, bool& ok) {
+        rows.clear();
+        string req(line);
+        req += '\n';
+        if (fd < 0 || !sendAll(fd, req)) return false;
+        string row;
+        while (in.next(row)) {
+            if (row == "OK" || row == "ERR") { ok = row == "OK"; return true; }
+            rows.push_back(move(row));
+        }
+        return false;
+    }
+private:
+    int fd = -1;
+    SocketLines in;
+};
+
+int runClient(const string& user, const string& path, const string& keyFile) {
+    if (!authenticate(user, keyFile)) return 1;
+    openUserShard(user);
+    return remoteBatch(cin, path.empty() ? SERVER_SOCKET : path);
+}
+
+int remoteBatch(istream& in, const string& sock) {
+    DiaryClient c;
+    if (!c.connect(sock)) { cerr << "No daemon is serving " << sock << "\n"; return 1; }
+    ios::sync_with_stdio(false);
+    string line, out;
+    vector<string> rows;
+    size_t lineNo = 0, errors = 0;
+    while (getline(in, line)) {
+        ++lineNo;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        bool ok;
+        if (!c.request(line, rows, ok)) { cerr << "Lost the connection to " << sock << "\n"; return 1; }
+        for (const string& r : rows) { out += r; out += '\n'; }
+        if (!ok) {
+            writeOut(out);
+            out.clear();
+            cerr << "line " << lineNo << ": cannot run: " << line << "\n";
+            ++errors;
+        }
+        if (out.size() >= (1 << 20)) { writeOut(out); out.clear(); }
+    }
+    writeOut(out);
+    return errors ? 1 : 0;
+}
+
+// ------- Menus over a daemon connection ----------
+struct RemoteItem {
+    const char* label;
+    const char* verb;
+    const char* prompt; // asks for the argument; nullptr if none
+};
+
+static const RemoteItem REMOTE_NOTES[] = {
+    {"Add Note", "add", nullptr},
+    {"View Notes", "view", nullptr},
+    {"Delete Single Note", "del", "Enter note number to delete: "},
+    {"Delete All Notes", "clear", nullptr},
+    {"Search Notes", "search", "Search words: "},
+    {"Notes Between Dates", "between", "From and to date (dd/mm/yyyy dd/mm/yyyy): "},
+    {"Delete Notes Older Than a Date", "clear before", "Delete notes older than (dd/mm/yyyy): "},
+    {"Undo", "undo", nullptr},
+    {"Redo", "redo", nullptr}};
+static const RemoteItem REMOTE_TASKS[] = {
+    {"Add Task", "add", "Enter task: "},
+    {"View Tasks", "view", nullptr},
+    {"Toggle Task", "toggle", "Enter task number: "},
+    {"Delete Task", "del", "Enter task number: "},
+    {"Tasks Between Dates", "between", "From and to date (dd/mm/yyyy dd/mm/yyyy): "},
+    {"Delete Completed Tasks", "clear done", nullptr},
+    {"Set Due Date", "due", "Task number and due date (N dd/mm/yyyy [hh:mm], or N - for none): "},
+    {"Set Priority", "priority", "Task number and priority (N 1-3, or N 0 for none): "},
+    {"Next Up", "next", nullptr},
+    {"Undo", "undo", nullptr},
+    {"Redo", "redo", nullptr}};
+static const RemoteItem REMOTE_CONTACTS[] = {
+    {"Add Contact", "add", nullptr},
+    {"View Contacts", "view", nullptr},
+    {"Delete Single Contact", "del", "Enter contact number to delete: "},
+    {"Delete All Contacts", "clear", nullptr},
+    {"Search Contacts", "find", "Name or phone prefix: "},
+    {"Contacts Between Dates", "between", "From and to date (dd/mm/yyyy dd/mm/yyyy): "},
+    {"Undo", "undo", nullptr},
+    {"Redo", "redo", nullptr}};
+
+// one reply row for the screen: tabs become gaps, and in note rows
+// escaped line breaks become real ones
+static void remoteRow(string& out, const string& row, bool note) {
+    out += INDENT;
+    for (size_t i = 0; i < row.size(); ++i) {
+        char ch = row[i];
+        if (ch == '\t') out += "   ";
+        else if (note && ch == '\\' && i + 1 < row.size()) {
+            ++i;
+            if (row[i] == 'n') { out += '\n'; out += INDENT; out += "   "; }
+            else out += row[i];
+        }
+        else out += ch;
+    }
+    out += '\n';
+}
+
+// read a prompted line
+static string remoteAsk(const char* prompt) {
+    string s;
+    cout << INDENT << YELLOW << prompt << RESET;
+    getline(cin, s);
+    return trimCR(s);
+}
+
+// one store's menu; false once the daemon is gone or input ends
+static bool remoteStoreMenu(DiaryClient& c, const char* store, const char* title, StatOp stat,
+                            const RemoteItem* items, size_t n) {
+    vector<string> rows;
+    while (true) {
+        cout << "\n" << INDENT << WHITE << " -- " << title << " -- " << RESET << "\n";
+        for (size_t i = 0; i < n; ++i) cout << INDENT << i + 1 << ". " << items[i].label << "\n";
+        cout << INDENT << "0. Back\n" << INDENT << "Choose: ";
+        int ch;
+        if (!(cin >> ch)) return false;
+        if (ch == 0) return true;
+        if (ch < 0 || ch > (int)n) { cout << INDENT << RED << "Invalid." << RESET << "\n"; continue; }
+        safeIgnoreNewline();
+        const RemoteItem& it = items[ch - 1];
+        string request = string(store) + " " + it.verb, arg;
+        bool isNote = strcmp(store, "note") == 0;
+        if (strcmp(it.verb, "add") == 0 && isNote) {
+            cout << INDENT << WHITE << BOLD << "Enter note (multi-line). End with a single line containing only ~" << RESET << "\n";
+            string line, content;
+            while (getline(cin, line) && trimCR(line) != "~") content += trimCR(line) + "\n";
+            if (!content.empty()) content.pop_back();
+            batchEscape(arg, content);
+        } else if (strcmp(it.verb, "add") == 0 && strcmp(store, "contact") == 0) {
+            arg = remoteAsk("Enter name: ");
+            arg += " | " + remoteAsk("Enter phone: ");
+        } else if (strcmp(it.verb, "clear") == 0) {
+            string yes = remoteAsk("Are you sure you want to DELETE ALL of them? (y/N): ");
+            if (yes != "y" && yes != "Y") { cout << INDENT << YELLOW << "Cancelled." << RESET << "\n"; continue; }
+        } else if (it.prompt) {
+            arg = remoteAsk(it.prompt);
+        }
+        if (!arg.empty()) request += " " + arg;
+        bool ok;
+        if (!c.request(request, rows, ok)) {
+            cout << INDENT << RED << "Lost the connection to the diary daemon." << RESET << "\n";
+            return false;
+        }
+        if (!ok) { cout << INDENT << RED << "Request failed." << RESET << "\n"; continue; }
+        if (batchIsWrite(request)) {
+            for (const string& r : rows) cout << INDENT << r << "\n";
+            cout << INDENT << CYAN << "Done." << RESET << "\n";
+        } else if (rows.empty()) {
+            cout << INDENT << YELLOW << "Nothing found." << RESET << "\n";
+        } else {
+            pagedView(stat, rows.size(), [&](string& out) {
+                out += INDENT + WHITE BOLD "---- " + it.label + " (" + to_string(rows.size()) + ") ----" RESET "\n";
+            }, [&](string& out, size_t i) { remoteRow(out, rows[i], isNote); });
+        }
+    }
+}
+
+bool remoteSession(const string& path) {
+    DiaryClient c;
+    if (!c.connect(path)) return false;
+    cout << INDENT << CYAN << "This diary is open in the diary daemon; working through it." << RESET << "\n";
+    vector<string> late;
+    bool ok;
+    if (c.request("task overdue", late, ok) && ok && !late.empty()) {
+        string out = "\n" + INDENT + RED BOLD "Overdue tasks:" RESET "\n";
+        for (size_t k = 0; k < late.size() && k < 5; ++k) remoteRow(out, late[k], false);
+        if (late.size() > 5) out += INDENT + "... and more under Tasks > Next Up\n";
+        writeOut(out);
+    }
+    while (true) {
+        cout << "\n" << INDENT << BG_BLUE_WHITE << " MAIN MENU " << RESET << "\n";
+        cout << INDENT << "1. Notes\n" << INDENT << "2. Tasks\n" << INDENT << "3. Contacts\n" << INDENT << "0. Exit\n";
+        cout << INDENT << "Choose: ";
+        int m;
+        if (!(cin >> m)) break;
+        bool alive = true;
+        if (m == 1) alive = remoteStoreMenu(c, "note", "NOTES", STAT_VIEW_NOTES, REMOTE_NOTES, size(REMOTE_NOTES));
+        else if (m == 2) alive = remoteStoreMenu(c, "task", "TASKS", STAT_VIEW_TASKS, REMOTE_TASKS, size(REMOTE_TASKS));
+        else if (m == 3) alive = remoteStoreMenu(c, "contact", "CONTACTS", STAT_VIEW_CONTACTS, REMOTE_CONTACTS, size(REMOTE_CONTACTS));
+        else if (m == 0) { cout << "\n" << INDENT << CYAN << "Exiting. Goodbye!" << RESET << "\n"; break; }
+        else cout << INDENT << RED << "Invalid choice." << RESET << "\n";
+        if (!alive) break;
+    }
+    return true;
+}
+#endif
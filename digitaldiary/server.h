@@ -0,0 +1,17 @@
+#pragma once
+
+#include "common.h"
+
+#ifndef _WIN32
+// ----------------------- Server -------------------------
+// Serve a user's diary to local clients over a UNIX socket ("" = default
+// path); only clients running as the same OS user are served
+int runServer(const string& user, const string& path, const string& keyFile);
+// Send stdin lines to a running daemon, printing its replies
+int runClient(const string& user, const string& path, const string& keyFile);
+// Send the lines of in to the daemon at path as batch commands,
+// printing its replies as batch mode would
+int remoteBatch(istream& in, const string& path);
+// Run the menus through the daemon at path; false if none is running
+bool remoteSession(const string& path);
+#endif
@@ -0,0 +1,496 @@
+#include "snapshot.h"
+#include "stores.h"
+
+// -------------------- Snapshots -------------------------
+// Binary image of one store (notes.bin / tasks.bin / contacts.bin):
+//   header   magic "DDSN", u16 version, u16 kind, u64 count,
+//            u64 log adds, u64 log ops, u64 text log size, u64 string
+//            bytes, u64 log skipped
+//   records  count x { i64 created, u64 seq, u8 done, u8 priority,
+//            u16 pad, u32 due } (priority and due minutes: tasks only,
+//            0 when unset; older writers leave them 0)
+//   strings  count x fields x { u32 length, bytes }
+// Version 4 (notes.bin with --pack-notes) keeps each note's content as
+// { u32 length, u32 block, u32 offset } among the strings, followed by
+//   blocks   u64 block count, count x { u64 file offset, u32 packed
+//            size, u32 raw size }, then the LZ-compressed blocks
+// Integers are stored in host byte order (little-endian on the targets
+// we build for). created is epoch seconds; when the record's date text
+// does not parse it is NO_TIME and the text is kept as the first string.
+// The snapshot is only used while the text log still has the size
+// recorded in the header, so any append or compaction invalidates it.
+// Versions 1 and 2 (plain, packed) are read too: their header ends
+// before the skipped count, which is 0 for them.
+const char SNAPSHOT_MAGIC[4] = {'D', 'D', 'S', 'N'};
+const uint16_t SNAPSHOT_VERSION = 3;
+const uint16_t SNAPSHOT_PACKED = 4; // note content in compressed blocks
+const size_t SNAPSHOT_HEADER = 56;
+const size_t SNAPSHOT_HEADER_V1 = 48;
+const size_t SNAPSHOT_RECORD = 24;
+
+// per-type hooks: kind id and string fields
+inline uint16_t snapshotKind(const Note*) { return 1; }
+inline uint16_t snapshotKind(const Task*) { return 2; }
+inline uint16_t snapshotKind(const Contact*) { return 3; }
+// string fields, from the schema: 0 is a date that does not parse,
+// then each Text and Body field in schema order
+template <typename T>
+constexpr int snapshotFields(const T*) {
+    return 1 + fieldCount<T>(FieldKind::Text) + fieldCount<T>(FieldKind::Body);
+}
+template <typename T>
+void getFields(const T& r, string_view* f) {
+    int k = 1;
+    forEachField<T>([&](const auto& field) {
+        constexpr FieldKind K = kindOf<decltype(field)>;
+        if constexpr (K == FieldKind::Text || K == FieldKind::Body) f[k++] = fieldText(r, field.member);
+    });
+}
+template <typename T>
+void setFields(T& r, const string_view* f) {
+    int k = 1;
+    forEachField<T>([&](const auto& field) {
+        constexpr FieldKind K = kindOf<decltype(field)>;
+        if constexpr (K == FieldKind::Text || K == FieldKind::Body) r.*field.member = f[k++];
+    });
+}
+// the record word after created and seq: done in the low byte, then a
+// priority field and, in the top half, a due field
+template <typename T>
+uint64_t snapshotExtra(const T& r) {
+    uint64_t v = 0;
+    forEachField<T>([&](const auto& field) {
+        constexpr FieldKind K = kindOf<decltype(field)>;
+        if constexpr (K == FieldKind::Priority) v |= uint64_t(r.*field.member) << 8;
+        else if constexpr (K == FieldKind::Due) v |= uint64_t(r.*field.member) << 32;
+    });
+    return v;
+}
+template <typename T>
+void setSnapshotExtra(T& r, uint64_t v) {
+    forEachField<T>([&](const auto& field) {
+        constexpr FieldKind K = kindOf<decltype(field)>;
+        if constexpr (K == FieldKind::Priority) r.*field.member = uint8_t(v >> 8) <= 3 ? uint8_t(v >> 8) : 0;
+        else if constexpr (K == FieldKind::Due) r.*field.member = uint32_t(v >> 32);
+    });
+}
+// only note content (field 1) is ever packed
+inline PackedText* packedTextOf(const Note*) { return &packedNotes; }
+template <typename T> PackedText* packedTextOf(const T*) { return nullptr; }
+inline void setPacked(Note& n, uint32_t block, uint32_t offset, uint32_t length) {
+    n.block = block;
+    n.offset = offset;
+    n.length = length;
+}
+template <typename T> void setPacked(T&, uint32_t, uint32_t, uint32_t) {}
+
+static size_t snapshotHeaderSize(uint16_t version) { return version <= 2 ? SNAPSHOT_HEADER_V1 : SNAPSHOT_HEADER; }
+static bool snapshotPacked(string_view image) {
+    uint16_t version = getRaw<uint16_t>(image.data() + 4);
+    return version == 2 || version == SNAPSHOT_PACKED;
+}
+
+static bool snapshotHeaderOk(string_view image) {
+    if (image.size() < SNAPSHOT_HEADER_V1 || memcmp(image.data(), SNAPSHOT_MAGIC, 4) != 0) return false;
+    uint16_t version = getRaw<uint16_t>(image.data() + 4);
+    return version >= 1 && version <= SNAPSHOT_PACKED && image.size() >= snapshotHeaderSize(version);
+}
+
+// true if the snapshot is valid and still matches its text log
+static bool snapshotCurrent(string_view image, const string& textPath, const string& binPath) {
+    return snapshotHeaderOk(image) && derivedFileCurrent(textPath, binPath, getRaw<uint64_t>(image.data() + 32));
+}
+
+// --pack-notes on | off
+bool parseNotePacking(const string& s) {
+    if (s == "on") notePacking = NotePacking::On;
+    else if (s == "off") notePacking = NotePacking::Off;
+    else return false;
+    return true;
+}
+
+// serialize a store into snapshot format; pack stores field 1 (note
+// content) in compressed blocks
+template <typename T>
+string buildSnapshot(const RecordStore<T>& s, int64_t textSize, bool pack = false) {
+    const int nf = snapshotFields((const T*)nullptr);
+    string out;
+    out.append(SNAPSHOT_MAGIC, 4);
+    putRaw<uint16_t>(out, pack ? SNAPSHOT_PACKED : SNAPSHOT_VERSION);
+    putRaw<uint16_t>(out, snapshotKind((const T*)nullptr));
+    putRaw<uint64_t>(out, s.size());
+    putRaw<uint64_t>(out, s.log.adds);
+    putRaw<uint64_t>(out, s.log.ops);
+    putRaw<uint64_t>(out, (uint64_t)max<int64_t>(textSize, 0));
+    size_t strBytesAt = out.size();
+    putRaw<uint64_t>(out, 0); // patched below
+    putRaw<uint64_t>(out, s.log.skipped);
+    string strings, raw, packed;
+    vector<pair<uint32_t, uint32_t>> blocks; // packed and raw size
+    auto flush = [&]() {
+        if (raw.empty()) return;
+        size_t before = packed.size();
+        lzCompress(raw, packed);
+        blocks.emplace_back((uint32_t)(packed.size() - before), (uint32_t)raw.size());
+        raw.clear();
+    };
+    string_view f[3];
+    for (size_t i = 0; i < s.size(); ++i) {
+        const T& r = s[i];
+        getFields(r, f);
+        f[0] = r.created == NO_TIME ? s.dateOf(r) : string_view();
+        putRaw<int64_t>(out, r.created);
+        putRaw<uint64_t>(out, r.seq);
+        putRaw<uint64_t>(out, (s.isDone(i) ? 1 : 0) | snapshotExtra(r));
+        for (int k = 0; k < nf; ++k) {
+            if (pack && k == 1) {
+                if (!raw.empty() && raw.size() + f[k].size() > PACK_BLOCK) flush();
+                putRaw<uint32_t>(strings, (uint32_t)f[k].size());
+                putRaw<uint32_t>(strings, (uint32_t)blocks.size());
+                putRaw<uint32_t>(strings, (uint32_t)raw.size());
+                raw += f[k];
+                continue;
+            }
+            putRaw<uint32_t>(strings, (uint32_t)f[k].size());
+            strings += f[k];
+        }
+    }
+    uint64_t strBytes = strings.size();
+    memcpy(&out[strBytesAt], &strBytes, sizeof(strBytes));
+    out += strings;
+    if (pack) {
+        flush();
+        putRaw<uint64_t>(out, blocks.size());
+        uint64_t at = out.size() + blocks.size() * 16;
+        for (const auto& b : blocks) {
+            putRaw<uint64_t>(out, at);
+            putRaw<uint32_t>(out, b.first);
+            putRaw<uint32_t>(out, b.second);
+            at += b.first;
+        }
+        out += packed;
+    }
+    return out;
+}
+
+// Load a store from its snapshot. Strings are views into the mapped
+// snapshot, dates are kept as epoch seconds. Packed note content is not touched:
+// its blocks are registered in packedNotes and inflated on first read.
+// Returns false if the snapshot is missing, stale (unless ignoreText)
+// or malformed.
+template <typename T>
+bool loadSnapshot(RecordStore<T>& s, const string& textPath, const string& binPath, bool ignoreText) {
+    if (fileSize(binPath) < (int64_t)SNAPSHOT_HEADER_V1) return false;
+    unique_ptr<MappedFile> img(new MappedFile());
+    if (!img->open(binPath)) return false;
+    string_view v = img->view();
+    if (ignoreText ? !snapshotHeaderOk(v) : !snapshotCurrent(v, textPath, binPath)) return false;
+    const char* p = v.data();
+    if (getRaw<uint16_t>(p + 6) != snapshotKind((const T*)nullptr)) return false;
+    PackedText* pt = packedTextOf((const T*)nullptr);
+    bool packed = snapshotPacked(v);
+    if (packed && !pt) return false;
+    size_t header = snapshotHeaderSize(getRaw<uint16_t>(p + 4));
+    uint64_t count = getRaw<uint64_t>(p + 8);
+    uint64_t strBytes = getRaw<uint64_t>(p + 40);
+    const int nf = snapshotFields((const T*)nullptr);
+    if (count > v.size() / SNAPSHOT_RECORD || strBytes > v.size()
+        || header + count * SNAPSHOT_RECORD + strBytes > v.size()) return false;
+    const char* rec = p + header;
+    const char* str = rec + count * SNAPSHOT_RECORD;
+    const char* end = str + strBytes;
+    if (!packed && end != v.data() + v.size()) return false;
+    // block table of a packed snapshot; only the sizes are checked here
+    vector<uint32_t> blockRaw;
+    if (pt) pt->clear();
+    if (packed) {
+        const char* t = end;
+        size_t left = size_t(v.data() + v.size() - t);
+        if (left < 8) return false;
+        uint64_t blocks = getRaw<uint64_t>(t);
+        t += 8;
+        if (blocks > (left - 8) / 16) return false;
+        for (uint64_t b = 0; b < blocks; ++b, t += 16) {
+            uint64_t at = getRaw<uint64_t>(t);
+            uint32_t packedSize = getRaw<uint32_t>(t + 8), rawSize = getRaw<uint32_t>(t + 12);
+            if (at > v.size() || packedSize > v.size() - at) { pt->clear(); return false; }
+            pt->add(v.data() + at, packedSize, rawSize);
+            blockRaw.push_back(rawSize);
+        }
+    }
+    s.reserve(count);
+    string_view f[3];
+    uint32_t pack[3] = {0, 0, 0}; // packed content: length, block, offset
+    auto fail = [&]() {
+        s.clearRecords();
+        if (pt) pt->clear();
+        return false;
+    };
+    for (uint64_t i = 0; i < count; ++i, rec += SNAPSHOT_RECORD) {
+        for (int k = 0; k < nf; ++k) {
+            if (packed && k == 1) {
+                if (end - str < 12) return fail();
+                for (int j = 0; j < 3; ++j) pack[j] = getRaw<uint32_t>(str + 4 * j);
+                str += 12;
+                if (pack[1] >= blockRaw.size() || pack[2] > blockRaw[pack[1]] || pack[0] > blockRaw[pack[1]] - pack[2])
+                    return fail();
+                f[k] = string_view();
+                continue;
+            }
+            if (end - str < 4) return fail();
+            uint32_t n = getRaw<uint32_t>(str);
+            str += 4;
+            if ((uint64_t)(end - str) < n) return fail();
+            f[k] = string_view(str, n);
+            str += n;
+        }
+        T r{};
+        setFields(r, f);
+        int64_t created = getRaw<int64_t>(rec);
+        setDate(r, s.oddDates, f[0], created);
+        r.seq = (uint32_t)getRaw<uint64_t>(rec + 8);
+        setSnapshotExtra(r, getRaw<uint64_t>(rec + 16));
+        if (packed) setPacked(r, pack[1], pack[2], pack[0]);
+        s.add(r, rec[16] != 0);
+    }
+    s.log.adds = getRaw<uint64_t>(p + 16);
+    s.log.ops = getRaw<uint64_t>(p + 24);
+    s.log.skipped = header > SNAPSHOT_HEADER_V1 ? getRaw<uint64_t>(p + 48) : 0;
+    s.files.push_back(move(img));
+    return true;
+}
+
+// write the snapshot for a store unless the one on disk is still
+// current and packed (or not) as --pack-notes asks. Not while deleted
+// records are kept for a saved undo step: snapshots hold live records
+// only, so the next session reads the log instead.
+template <typename T>
+bool saveSnapshot(RecordStore<T>& s, const string& textPath, const string& binPath) {
+    logWait(s.log);
+    if (keepUndo && s.keepsDead()) return true;
+    bool pack = false;
+    {
+        MappedFile img;
+        bool have = img.open(binPath) && snapshotHeaderOk(img.view());
+        bool wasPacked = have && snapshotPacked(img.view());
+        pack = packedTextOf((const T*)nullptr) != nullptr
+            && (notePacking == NotePacking::On || (notePacking == NotePacking::Keep && wasPacked));
+        bool latest = have && snapshotHeaderSize(getRaw<uint16_t>(img.view().data() + 4)) == SNAPSHOT_HEADER;
+        if (latest && pack == wasPacked && snapshotCurrent(img.view(), textPath, binPath)) return true;
+    }
+    return writeFileAtomic(binPath, buildSnapshot(s, fileSize(textPath), pack));
+}
+
+// Write notes.bin / tasks.bin / contacts.bin for the loaded stores
+void saveSnapshots() {
+    if (notes.loaded) saveSnapshot(notes, NOTES_FILE, NOTES_SNAPSHOT);
+    if (tasks.loaded) saveSnapshot(tasks, TASKS_FILE, TASKS_SNAPSHOT);
+    if (contacts.loaded) saveSnapshot(contacts, CONTACTS_FILE, CONTACTS_SNAPSHOT);
+}
+
+// ---------------------- Undo Files -----------------------
+// With --keep-undo, each store's undo and redo steps are kept in
+// notes.undo / tasks.undo / contacts.undo between sessions:
+//   header   magic "DDUN", u16 version, u16 kind
+//   now      live and done sets of the store as saved
+//   steps    u32 undo count, that many steps oldest first, then
+//            u32 redo count and the redo steps
+//   step     u32 label length, label bytes, live and done before,
+//            live and done after, u32 edit count, count x { u32 seq,
+//            u32 due before, u32 due after, u8 priority before,
+//            u8 priority after }
+// Sets are PersistentBits::save images sharing one node table, so a
+// node the versions have in common is written once. The steps are
+// only used while the store loads to exactly the saved sets.
+const char UNDO_MAGIC[4] = {'D', 'D', 'U', 'N'};
+const uint16_t UNDO_VERSION = 1;
+
+static bool takeU32(string_view& in, uint32_t& v) {
+    if (in.size() < 4) return false;
+    v = getRaw<uint32_t>(in.data());
+    in.remove_prefix(4);
+    return true;
+}
+
+static void saveVersion(string& out, PersistentBits::Table& t, const StoreHistory::Version& v) {
+    v.live.save(out, t);
+    v.done.save(out, t);
+}
+
+static bool loadVersion(string_view& in, PersistentBits::Table& t, StoreHistory::Version& v) {
+    return v.live.load(in, t) && v.done.load(in, t);
+}
+
+static void saveStep(string& out, PersistentBits::Table& t, const StoreHistory::Step& s) {
+    putRaw<uint32_t>(out, (uint32_t)s.label.size());
+    out += s.label;
+    saveVersion(out, t, s.before);
+    saveVersion(out, t, s.after);
+    putRaw<uint32_t>(out, (uint32_t)s.edits.size());
+    for (const StoreHistory::Edit& e : s.edits) {
+        putRaw<uint32_t>(out, e.seq);
+        putRaw<uint32_t>(out, e.dueBefore);
+        putRaw<uint32_t>(out, e.dueAfter);
+        putRaw<uint8_t>(out, e.priorityBefore);
+        putRaw<uint8_t>(out, e.priorityAfter);
+    }
+}
+
+static bool loadStep(string_view& in, PersistentBits::Table& t, StoreHistory::Step& s) {
+    const size_t EDIT_BYTES = 14;
+    uint32_t n;
+    if (!takeU32(in, n) || in.size() < n) return false;
+    s.label.assign(in.data(), n);
+    in.remove_prefix(n);
+    if (!loadVersion(in, t, s.before) || !loadVersion(in, t, s.after) || !takeU32(in, n)) return false;
+    if (in.size() / EDIT_BYTES < n) return false;
+    s.edits.resize(n);
+    for (StoreHistory::Edit& e : s.edits) {
+        const char* p = in.data();
+        e.seq = getRaw<uint32_t>(p);
+        e.dueBefore = getRaw<uint32_t>(p + 4);
+        e.dueAfter = getRaw<uint32_t>(p + 8);
+        e.priorityBefore = getRaw<uint8_t>(p + 12);
+        e.priorityAfter = getRaw<uint8_t>(p + 13);
+        if (e.priorityBefore > 3 || e.priorityAfter > 3) return false;
+        in.remove_prefix(EDIT_BYTES);
+    }
+    return true;
+}
+
+// Read the steps saved for s (before it loads, so compacting while it
+// loads keeps what they can bring back); the sets they were saved
+// with go to history.saved until startHistory checks them
+template <typename T>
+void readHistory(RecordStore<T>& s, const string& path) {
+    if (!keepUndo || !undoDepth) return;
+    MappedFile f;
+    if (!f.open(path)) return;
+    string_view in = f.view();
+    StoreHistory& h = s.history;
+    if (in.size() < 8 || memcmp(in.data(), UNDO_MAGIC, 4) != 0 || getRaw<uint16_t>(in.data() + 4) != UNDO_VERSION
+        || getRaw<uint16_t>(in.data() + 6) != snapshotKind((const T*)nullptr))
+        return;
+    in.remove_prefix(8);
+    PersistentBits::Table t;
+    bool ok = loadVersion(in, t, h.saved);
+    for (deque<StoreHistory::Step>* d : {&h.undo, &h.redo}) {
+        uint32_t n = 0;
+        ok = ok && takeU32(in, n);
+        for (uint32_t i = 0; ok && i < n; ++i) {
+            StoreHistory::Step step;
+            ok = loadStep(in, t, step);
+            d->push_back(move(step));
+        }
+    }
+    if (!ok || !in.empty()) h.clear();
+    while (h.undo.size() > undoDepth) h.undo.pop_front();
+    while (h.redo.size() > undoDepth) h.redo.pop_front();
+}
+
+// Start tracking s once it has loaded. Steps read by readHistory stay
+// only if s loaded to the sets they were saved with and still holds
+// every record they can bring back; otherwise the file was for other
+// data (written by another version, or the log changed without it).
+template <typename T>
+void startHistory(RecordStore<T>& s) {
+    if (!undoDepth) return;
+    StoreHistory& h = s.history;
+    StoreHistory::Version read = h.saved;
+    s.trackHistory();
+    bool ok = !h.undo.empty() || !h.redo.empty();
+    if (ok) {
+        vector<uint32_t> ids;
+        PersistentBits::diff(h.now.live, read.live, ids);
+        PersistentBits::diff(h.now.done, read.done, ids);
+        ok = ids.empty();
+        PersistentBits::diff(h.kept(), h.now.live, ids);
+        for (size_t i = 0; ok && i < ids.size(); ++i) ok = s.slotOfSeq(ids[i]) != SIZE_MAX;
+    }
+    if (ok) {
+        h.now = h.saved = read; // shares nodes with the steps
+    } else {
+        h.undo.clear();
+        h.redo.clear();
+        h.saved = h.now;
+    }
+}
+
+// Write the steps of s for the next session (--keep-undo)
+template <typename T>
+void saveHistory(RecordStore<T>& s, const string& path) {
+    if (!keepUndo || !s.loaded) return;
+    StoreHistory& h = s.history;
+    recordUndo(s, "Other changes");
+    if (h.undo.empty() && h.redo.empty()) {
+        remove(path.c_str());
+        return;
+    }
+    string out(UNDO_MAGIC, 4);
+    putRaw<uint16_t>(out, UNDO_VERSION);
+    putRaw<uint16_t>(out, snapshotKind((const T*)nullptr));
+    PersistentBits::Table t;
+    saveVersion(out, t, h.now);
+    for (const deque<StoreHistory::Step>* d : {&h.undo, &h.redo}) {
+        putRaw<uint32_t>(out, (uint32_t)d->size());
+        for (const StoreHistory::Step& step : *d) saveStep(out, t, step);
+    }
+    writeFileAtomic(path, out);
+}
+
+// Write notes.undo / tasks.undo / contacts.undo for the loaded stores
+void saveUndoHistories() {
+    saveHistory(notes, NOTES_UNDO);
+    saveHistory(tasks, TASKS_UNDO);
+    saveHistory(contacts, CONTACTS_UNDO);
+}
+
+// Converter: parse the text logs and write fresh snapshots
+bool textToSnapshots() {
+    // drop current snapshots so the loaders read the text logs
+    remove(NOTES_SNAPSHOT.c_str());
+    remove(TASKS_SNAPSHOT.c_str());
+    remove(CONTACTS_SNAPSHOT.c_str());
+    loadNotes();
+    loadTasks();
+    loadContacts();
+    bool ok = saveSnapshot(notes, NOTES_FILE, NOTES_SNAPSHOT)
+           && saveSnapshot(tasks, TASKS_FILE, TASKS_SNAPSHOT)
+           && saveSnapshot(contacts, CONTACTS_FILE, CONTACTS_SNAPSHOT);
+    cout << (ok ? "Snapshots written: " : "Snapshot write failed: ")
+         << notes.size() << " notes, " << tasks.size() << " tasks, " << contacts.size() << " contacts\n";
+    return ok;
+}
+
+// Converter: rebuild the text logs (compacted) from the snapshots
+template <typename T>
+bool snapshotToText(RecordStore<T>& s, const string& textPath, const string& binPath) {
+    logWait(s.log);
+    s.clear();
+    s.log.path = textPath;
+    if (!loadSnapshot(s, textPath, binPath, true)) return fileSize(binPath) < 0;
+    return writeFileAtomic(textPath, freezeLive(s).format()) && saveSnapshot(s, textPath, binPath);
+}
+
+bool snapshotsToText() {
+    bool ok = snapshotToText(notes, NOTES_FILE, NOTES_SNAPSHOT)
+           && snapshotToText(tasks, TASKS_FILE, TASKS_SNAPSHOT)
+           && snapshotToText(contacts, CONTACTS_FILE, CONTACTS_SNAPSHOT);
+    cout << (ok ? "Text files written: " : "Text write failed: ")
+         << notes.size() << " notes, " << tasks.size() << " tasks, " << contacts.size() << " contacts\n";
+    return ok;
+}
+
+// the stores snapshots are written for
+template bool loadSnapshot(RecordStore<Note>&, const string&, const string&, bool);
+template bool loadSnapshot(RecordStore<Task>&, const string&, const string&, bool);
+template bool loadSnapshot(RecordStore<Contact>&, const string&, const string&, bool);
+template bool saveSnapshot(RecordStore<Note>&, const string&, const string&);
+template bool saveSnapshot(RecordStore<Task>&, const string&, const string&);
+template bool saveSnapshot(RecordStore<Contact>&, const string&, const string&);
+template void readHistory(RecordStore<Note>&, const string&);
+template void readHistory(RecordStore<Task>&, const string&);
+template void readHistory(RecordStore<Contact>&, const string&);
+template void startHistory(RecordStore<Note>&);
+template void startHistory(RecordStore<Task>&);
+template void startHistory(RecordStore<Contact>&);
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "record_store.h"
+
+// -------------------- Snapshots -------------------------
+// Write notes.bin / tasks.bin / contacts.bin unless already current
+void saveSnapshots();
+// Write notes.undo / tasks.undo / contacts.undo (--keep-undo)
+void saveUndoHistories();
+// Parse a --pack-notes value
+bool parseNotePacking(const string& s);
+// Converters: text logs -> snapshots, snapshots -> text logs
+bool textToSnapshots();
+bool snapshotsToText();
+// Load a store from its snapshot; false if missing, stale (unless
+// ignoreText) or malformed
+template <typename T>
+bool loadSnapshot(RecordStore<T>& s, const string& textPath, const string& binPath, bool ignoreText = false);
+// Write a store's snapshot unless the one on disk is still current
+template <typename T> bool saveSnapshot(RecordStore<T>& s, const string& textPath, const string& binPath);
+// Read the undo steps saved for a store before it loads, and check
+// them against it once it has (--keep-undo)
+template <typename T> void readHistory(RecordStore<T>& s, const string& path);
+template <typename T> void startHistory(RecordStore<T>& s);
@@ -0,0 +1,90 @@
+#include "common.h"
+#include "files.h"
+#include "terminal.h"
+
+// ---------------------- Statistics -----------------------
+OpStats opStats[STAT_OPS];
+IoStats ioStats;
+
+// -------------------- Stats View ------------------------
+
+#ifndef DIARY_NO_STATS
+// upper bound in microseconds of the bucket holding the pct-th percentile
+static uint64_t statQuantile(const OpStats& s, uint64_t count, unsigned pct) {
+    uint64_t want = (count * pct + 99) / 100, seen = 0;
+    for (int b = 0; b < STAT_BUCKETS; ++b) {
+        seen += s.buckets[b].load(memory_order_relaxed);
+        if (seen >= want) return 1ull << b;
+    }
+    return 1ull << (STAT_BUCKETS - 1);
+}
+#endif
+
+// Percentiles are bucket bounds (powers of two), so "p99 256" reads as
+// "99% of calls took under 256 microseconds".
+void showStats() {
+#ifdef DIARY_NO_STATS
+    cout << INDENT << YELLOW << "Statistics were compiled out (DIARY_NO_STATS)." << RESET << "\n";
+#else
+    string out;
+    out += INDENT + WHITE + BOLD + "---- Statistics (microseconds) ----" + RESET + "\n" + INDENT;
+    padRight(out, "operation", 18);
+    padLeft(out, "count", 9);
+    padLeft(out, "avg", 10);
+    padLeft(out, "p50", 10);
+    padLeft(out, "p99", 10);
+    padLeft(out, "max", 10);
+    out += "\n";
+    for (int op = 0; op < STAT_OPS; ++op) {
+        const OpStats& s = opStats[op];
+        uint64_t count = s.count.load(memory_order_relaxed);
+        if (!count) continue;
+        out += INDENT;
+        padRight(out, STAT_NAMES[op], 18);
+        padLeft(out, to_string(count), 9);
+        padLeft(out, to_string(s.totalNs.load(memory_order_relaxed) / count / 1000), 10);
+        padLeft(out, "<" + to_string(statQuantile(s, count, 50)), 10);
+        padLeft(out, "<" + to_string(statQuantile(s, count, 99)), 10);
+        padLeft(out, to_string(s.maxNs.load(memory_order_relaxed) / 1000), 10);
+        out += "\n";
+    }
+    out += INDENT + "files opened " + to_string(ioStats.fileOpens.load(memory_order_relaxed))
+         + ", bytes read " + to_string(ioStats.bytesRead.load(memory_order_relaxed))
+         + ", bytes written " + to_string(ioStats.bytesWritten.load(memory_order_relaxed)) + "\n";
+    out += INDENT + "key work factor " + to_string(keyIterations) + " PBKDF2 iterations (key_derive above)\n";
+    writeOut(out);
+#endif
+}
+
+void dumpStats() {
+#ifndef DIARY_NO_STATS
+    const char* path = getenv("DIARY_STATS_FILE");
+    if (!path || !*path) return;
+    string out = "{\"ops\":{";
+    bool first = true;
+    for (int op = 0; op < STAT_OPS; ++op) {
+        const OpStats& s = opStats[op];
+        uint64_t count = s.count.load(memory_order_relaxed);
+        if (!count) continue;
+        if (!first) out += ",";
+        first = false;
+        out += "\"" + string(STAT_NAMES[op]) + "\":{\"count\":" + to_string(count)
+             + ",\"total_us\":" + to_string(s.totalNs.load(memory_order_relaxed) / 1000)
+             + ",\"max_us\":" + to_string(s.maxNs.load(memory_order_relaxed) / 1000)
+             + ",\"p50_us\":" + to_string(statQuantile(s, count, 50))
+             + ",\"p99_us\":" + to_string(statQuantile(s, count, 99)) + ",\"buckets\":[";
+        int last = STAT_BUCKETS - 1;
+        while (last > 0 && !s.buckets[last].load(memory_order_relaxed)) --last;
+        for (int b = 0; b <= last; ++b) {
+            if (b) out += ",";
+            out += to_string(s.buckets[b].load(memory_order_relaxed));
+        }
+        out += "]}";
+    }
+    out += "},\"io\":{\"file_opens\":" + to_string(ioStats.fileOpens.load(memory_order_relaxed))
+         + ",\"bytes_read\":" + to_string(ioStats.bytesRead.load(memory_order_relaxed))
+         + ",\"bytes_written\":" + to_string(ioStats.bytesWritten.load(memory_order_relaxed))
+         + "},\"key_iterations\":" + to_string(keyIterations) + "}\n";
+    if (!writeFileAtomic(path, out)) cerr << "Cannot write stats to " << path << "\n";
+#endif
+}
@@ -0,0 +1,231 @@
+#include "store_log.h"
+#include "files.h"
+#include "stores.h"
+
+// ------------------- Operation Log ---------------------
+// Write the log's buffer to its file (and fsync if sync); caller holds
+// log.m. On a short write only the unwritten tail stays in the buffer,
+// so the next flush carries on where this one stopped.
+static void logFlushLocked(StoreLog& log, bool sync) {
+    if (!log.buf.empty()) {
+        if (!log.file) {
+            log.file = fopen(log.path.c_str(), "ab");
+            if (!log.file) return;
+            STAT_IO(fileOpens, 1);
+        }
+        size_t put = fwrite(log.buf.data(), 1, log.buf.size(), log.file);
+        STAT_IO(bytesWritten, put);
+        log.buf.erase(0, put);
+        if (put) log.unsynced = true;
+        if (!log.buf.empty()) return;
+    }
+    if (log.file && log.unsynced) {
+        if (sync) log.unsynced = !syncFile(log.file);
+        else fflush(log.file);
+    }
+}
+
+// add entries to the end of the log per the durability mode; caller holds log.m
+static void logWriteLocked(StoreLog& log, string_view entries) {
+    if (log.compacting) { log.pending += entries; return; }
+    log.buf += entries;
+    if (durability == Durability::Interval) startLogSync();
+    if (durability == Durability::PerOp) logFlushLocked(log, true);
+    else if (durability == Durability::None && log.buf.size() >= LOG_BUFFER_BYTES) logFlushLocked(log, false);
+}
+
+// Append one serialized entry. While a compaction is running the
+// entry is held back and written after the compacted snapshot. In
+// batch mode entries collect in held and go out in large chunks.
+void logAppend(StoreLog& log, const string& entry) {
+    lock_guard<mutex> g(log.m);
+    if (log.holding) {
+        log.held += entry;
+        if (log.held.size() >= HOLD_FLUSH_BYTES) { logWriteLocked(log, log.held); log.held.clear(); }
+        return;
+    }
+    logWriteLocked(log, entry);
+}
+
+// Append a tombstone (#DEL) or toggle (#TGL) for the seq-th record
+void logOp(StoreLog& log, const char* op, size_t seq) {
+    logAppend(log, string(op) + " " + to_string(seq) + "\n");
+    log.ops++;
+}
+
+// op is 'D' for #DEL, 'T' for #TGL, 'S' for #SEQ and 'R' for #RES
+bool parseLogOp(string_view line, char& op, size_t& seq) {
+    if (line.size() < 6 || line[0] != '#' || line[4] != ' ') return false;
+    if (line.compare(1, 3, "DEL") == 0) op = 'D';
+    else if (line.compare(1, 3, "TGL") == 0) op = 'T';
+    else if (line.compare(1, 3, "SEQ") == 0) op = 'S';
+    else if (line.compare(1, 3, "RES") == 0) op = 'R';
+    else return false;
+    seq = 0;
+    for (size_t i = 5; i < line.size(); ++i) {
+        if (line[i] < '0' || line[i] > '9') return false;
+        seq = seq * 10 + (line[i] - '0');
+    }
+    return true;
+}
+
+// Persistence worker: one background thread runs the queued
+// compactions in order, so building and writing a new log never holds
+// up the caller. closeLogs drains the queue and stops it.
+static thread persistThread;
+static mutex persistMutex;
+static condition_variable persistWake;
+static deque<function<void()>> persistQueue;
+static bool persistStop = false;
+
+static void persistLoop() {
+    unique_lock<mutex> lk(persistMutex);
+    while (true) {
+        persistWake.wait(lk, []() { return persistStop || !persistQueue.empty(); });
+        if (persistQueue.empty()) return; // stopping, nothing left
+        function<void()> job = move(persistQueue.front());
+        persistQueue.pop_front();
+        lk.unlock();
+        job();
+        lk.lock();
+    }
+}
+
+static void persistPush(function<void()> job) {
+    lock_guard<mutex> g(persistMutex);
+    if (!persistThread.joinable()) {
+        persistStop = false;
+        persistThread = thread(persistLoop);
+    }
+    persistQueue.push_back(move(job));
+    persistWake.notify_one();
+}
+
+// true while a compaction of the log is queued or running
+bool logCompacting(StoreLog& log) {
+    lock_guard<mutex> g(log.m);
+    return log.compacting;
+}
+
+// Replace the log with the text build() returns. build runs on the
+// persistence worker and must only read state frozen for it; the new
+// log is written to a temp file there, entries appended meanwhile are
+// added to the end of it and the temp file is renamed over the log in
+// one step. Callers skip compacting while one is already pending
+// (logCompacting): it covers the dead weight that asked for this one.
+void logCompact(StoreLog& log, function<string()> build) {
+    string unwritten;
+    {
+        // held and buffered entries are already part of the in-memory
+        // state build() was frozen from; the file is about to be
+        // replaced, and they only go to the old one if that fails
+        lock_guard<mutex> g(log.m);
+        log.compacting = true;
+        unwritten = move(log.buf) + move(log.held);
+        log.held.clear();
+        log.buf.clear();
+        if (log.file) { fclose(log.file); log.file = nullptr; }
+        log.unsynced = false;
+    }
+    persistPush([&log, build = move(build), unwritten = move(unwritten)]() {
+        string snapshot = build();
+        string tmp = log.path + ".tmp";
+        FILE* f = fopen(tmp.c_str(), "wb");
+        if (f) STAT_IO(fileOpens, 1);
+        size_t put = f ? fwrite(snapshot.data(), 1, snapshot.size(), f) : 0;
+        STAT_IO(bytesWritten, put);
+        bool ok = f && put == snapshot.size();
+        lock_guard<mutex> g(log.m);
+        if (ok) {
+            put = fwrite(log.pending.data(), 1, log.pending.size(), f);
+            STAT_IO(bytesWritten, put);
+            ok = put == log.pending.size();
+        }
+        if (f) ok = syncClose(f) && ok;
+        if (ok) ok = replaceFile(tmp, log.path);
+        if (!ok) {
+            // the old log is never touched but for appending what it
+            // lacks; kept in buf (and retried by every flush) until then
+            remove(tmp.c_str());
+            cerr << "Could not compact " << log.path << "; keeping the old file\n";
+            log.buf = unwritten + log.pending;
+            logFlushLocked(log, true);
+        }
+        log.compactFailed = !ok;
+        log.pending.clear();
+        log.compacting = false;
+        log.idle.notify_all();
+    });
+}
+
+// Wait for a queued or running compaction of the log to finish
+void logWait(StoreLog& log) {
+    unique_lock<mutex> lk(log.m);
+    log.idle.wait(lk, [&]() { return !log.compacting; });
+}
+
+// Start holding appends in memory (batch mode)
+void logHold(StoreLog& log) {
+    lock_guard<mutex> g(log.m);
+    log.holding = true;
+}
+
+// Group commit for Interval mode: one thread writes and fsyncs the
+// buffered appends of every store together every syncIntervalMs
+static thread logSyncThread;
+static mutex logSyncMutex;
+static condition_variable logSyncWake;
+static bool logSyncStop = false;
+
+void startLogSync() {
+    if (durability != Durability::Interval || logSyncThread.joinable()) return;
+    logSyncStop = false;
+    logSyncThread = thread([]() {
+        unique_lock<mutex> lk(logSyncMutex);
+        while (!logSyncStop) {
+            logSyncWake.wait_for(lk, chrono::milliseconds(syncIntervalMs));
+            for (StoreLog* log : storeLogs) {
+                lock_guard<mutex> g(log->m);
+                logFlushLocked(*log, true);
+            }
+        }
+    });
+}
+
+// Write out and close all store logs; fsynced unless durability is None.
+// Queued compactions finish first.
+void closeLogs() {
+    if (persistThread.joinable()) {
+        { lock_guard<mutex> g(persistMutex); persistStop = true; }
+        persistWake.notify_all();
+        persistThread.join();
+    }
+    if (logSyncThread.joinable()) {
+        { lock_guard<mutex> g(logSyncMutex); logSyncStop = true; }
+        logSyncWake.notify_all();
+        logSyncThread.join();
+    }
+    for (StoreLog* log : storeLogs) {
+        lock_guard<mutex> g(log->m);
+        logFlushLocked(*log, durability != Durability::None);
+        if (log->file) { fclose(log->file); log->file = nullptr; }
+    }
+}
+
+// --durability none | op | MS (group commit interval in milliseconds)
+bool parseDurability(const string& s) {
+    if (s == "none") { durability = Durability::None; return true; }
+    if (s == "op") { durability = Durability::PerOp; return true; }
+    if (s.empty() || s.size() > 6 || s.find_first_not_of("0123456789") != string::npos) return false;
+    durability = Durability::Interval;
+    syncIntervalMs = max(1, stoi(s));
+    return true;
+}
+
+// Stop holding and write whatever is still held with a single append
+void logCommit(StoreLog& log) {
+    lock_guard<mutex> g(log.m);
+    log.holding = false;
+    if (!log.held.empty()) logWriteLocked(log, log.held);
+    log.held.clear();
+}
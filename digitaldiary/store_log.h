@@ -0,0 +1,54 @@
+#pragma once
+
+#include "common.h"
+
+// --------------------- Operation Log ---------------------
+// Every store file is an append-only log. Record blocks are "add"
+// entries, each giving its record the next id (seq); top-level
+// "#DEL n" / "#TGL n" lines delete or toggle the record with id n, and
+// "#RES n" (undo) brings back the deleted record n.
+// Files without op lines load exactly as before. Compaction rewrites
+// only live records on a worker thread and swaps the result in with an
+// atomic rename. Ids never change: where deleted records leave a gap,
+// compaction writes "#SEQ n" to make n the id of the next add.
+// Compactions are queued to the persistence worker; see logCompact.
+struct StoreLog {
+    string path;
+    size_t adds = 0;          // ids handed out so far (next seq)
+    size_t skipped = 0;       // ids with no add entry in the file (#SEQ gaps)
+    size_t ops = 0;           // op lines (#DEL, #TGL, ...) in the file
+    mutex m;                  // guards the file, compacting and pending
+    bool compacting = false;
+    string pending;           // appends that arrived during compaction
+    condition_variable idle;  // signalled when a compaction finishes
+    bool holding = false;     // batch mode: appends collect in held
+    string held;              // written by logCommit or when it grows large
+    FILE* file = nullptr;     // kept open for appends, reopened after compaction
+    string buf;               // appends not yet written to file
+    bool unsynced = false;    // written but not fsynced yet
+    atomic<bool> compactFailed{false}; // the last compaction kept the old log
+};
+
+// ------------------- Operation Log ---------------------
+// Append one serialized entry to the log (queued while compacting)
+void logAppend(StoreLog& log, const string& entry);
+// Append a "#DEL n" / "#TGL n" op line
+void logOp(StoreLog& log, const char* op, size_t seq);
+// Recognise an op line while replaying a log
+bool parseLogOp(string_view line, char& op, size_t& seq);
+// Queue a compaction to the persistence worker; build() makes the new log.
+// If it cannot be swapped in, the old log stays and gets the entries it
+// lacks appended, and compactFailed is set so the store tries again.
+void logCompact(StoreLog& log, function<string()> build);
+bool logCompacting(StoreLog& log);
+// Wait for a store's queued or running compaction to finish
+void logWait(StoreLog& log);
+// Batch mode: hold appends in memory until logCommit writes them at once
+void logHold(StoreLog& log);
+void logCommit(StoreLog& log);
+// Parse a --durability value
+bool parseDurability(const string& s);
+// Start the background group commit (Interval mode, on first append)
+void startLogSync();
+// Write out and close all store logs (stops the group commit)
+void closeLogs();
@@ -0,0 +1,435 @@
+#include "stores.h"
+#include "snapshot.h"
+
+// ------- In-memory storage ----------
+RecordStore<Note> notes;
+RecordStore<Task> tasks;
+RecordStore<Contact> contacts;
+NoteIndex noteIndex;
+ContactIndex contactIndex;
+TaskSchedule taskSchedule;
+PackedText packedNotes;
+StoreLog* const storeLogs[3] = { &notes.log, &tasks.log, &contacts.log };
+
+// ------------------- Parallel Loading -------------------
+// Run body(0..n-1) on up to hardware_concurrency worker threads.
+// Workers pull indices from a shared counter, so uneven chunks balance.
+void parallelFor(size_t n, const function<void(size_t)>& body) {
+    size_t workers = min<size_t>(n, max(1u, thread::hardware_concurrency()));
+    if (workers <= 1) { for (size_t i = 0; i < n; ++i) body(i); return; }
+    atomic<size_t> next(0);
+    vector<thread> pool;
+    for (size_t w = 0; w < workers; ++w)
+        pool.emplace_back([&]() { for (size_t i; (i = next++) < n;) body(i); });
+    for (thread& t : pool) t.join();
+}
+
+// Start of the line after the first "---" separator at or after pos
+// (after the "~" line that ends a note when afterTilde), or npos.
+static size_t nextBlockBoundary(string_view img, size_t pos, bool afterTilde) {
+    while (true) {
+        size_t at = img.find("\n---", pos);
+        if (at == string_view::npos) return string_view::npos;
+        size_t end = at + 4;
+        if (end < img.size() && img[end] == '\r') ++end;
+        if (end < img.size() && img[end] == '\n') {
+            size_t ls = at == 0 ? string_view::npos : img.rfind('\n', at - 1);
+            ls = (ls == string_view::npos) ? 0 : ls + 1;
+            string_view before = img.substr(ls, at - ls);
+            if (!afterTilde || before == "~" || before == "~\r") return end + 1;
+        }
+        pos = at + 1;
+    }
+}
+// Where a piece of a T log may start: after a line, or after a block
+// (and its body, if it has one)
+template <typename T>
+size_t recordBoundary(string_view img, size_t pos) {
+    if constexpr (Schema<T>::layout == RecordLayout::Line) {
+        size_t at = img.find('\n', pos);
+        return at == string_view::npos ? at : at + 1;
+    } else {
+        return nextBlockBoundary(img, pos, fieldCount<T>(FieldKind::Body) > 0);
+    }
+}
+
+// Replay a log image into s. Large images are cut at record boundaries
+// and the pieces parsed in parallel; every piece must end between
+// records (as the serial parse would at that point), otherwise the
+// whole image is parsed again in one piece. Pieces are merged in file
+// order and each op is applied where it stood among the adds, so the
+// result is identical to a serial replay.
+template <typename T>
+void loadLog(RecordStore<T>& s, string_view img,
+             void (*parse)(string_view, ParsedChunk<T>&),
+             size_t (*boundary)(string_view, size_t)) {
+    vector<size_t> cuts(1, 0);
+    size_t workers = max(1u, thread::hardware_concurrency());
+    if (img.size() >= PARALLEL_MIN_BYTES && workers > 1) {
+        size_t pieces = workers * 4, step = img.size() / pieces;
+        for (size_t k = 1; k < pieces; ++k) {
+            size_t at = boundary(img, max(cuts.back(), k * step));
+            if (at == string_view::npos || at >= img.size()) break;
+            if (at > cuts.back()) cuts.push_back(at);
+        }
+    }
+    cuts.push_back(img.size());
+    vector<ParsedChunk<T>> parts(cuts.size() - 1);
+    parallelFor(parts.size(), [&](size_t i) {
+        parse(img.substr(cuts[i], cuts[i + 1] - cuts[i]), parts[i]);
+    });
+    for (size_t i = 0; i + 1 < parts.size(); ++i) {
+        if (!parts[i].clean) {
+            parts.clear();
+            parts.resize(1);
+            parse(img, parts[0]);
+            break;
+        }
+    }
+    size_t total = 0;
+    for (auto& p : parts) total += p.records.size();
+    s.reserve(total);
+    size_t next = 0; // id of the next add
+    for (auto& p : parts) {
+        uint32_t oddBase = (uint32_t)s.oddDates.size() - 1;
+        s.oddDates.insert(s.oddDates.end(), p.oddDates.begin() + 1, p.oddDates.end());
+        size_t k = 0;
+        auto addUpTo = [&](size_t end) {
+            for (; k < end; ++k) {
+                T& r = p.records[k];
+                r.seq = (uint32_t)next++;
+                if (r.oddDate) r.oddDate += oddBase;
+                s.add(r, k < p.done.size() && p.done.test(k));
+            }
+        };
+        for (const LogOpRef& o : p.ops) {
+            addUpTo(o.addsBefore);
+            if (o.op == 'S') {
+                // ids only move forward
+                if (o.seq > next && o.seq <= UINT32_MAX) { s.log.skipped += o.seq - next; next = o.seq; }
+                continue;
+            }
+            if (o.op == 'R') {
+                size_t k = s.slotOfSeq(o.seq);
+                if (k != SIZE_MAX && s.dead.test(k)) s.revive(k);
+                s.log.ops++;
+                continue;
+            }
+            size_t at = s.indexOfSeq(o.seq);
+            if (at != SIZE_MAX) {
+                if (o.op == 'D') s.erase(at);
+                else if (o.op == 'U') applySchedule(s, at, o);
+                else applyToggle(s, at);
+            }
+            s.log.ops++;
+        }
+        addUpTo(p.records.size());
+        s.text.absorb(p.text);
+    }
+    s.log.adds = next;
+    s.vacuum();
+}
+
+// Load all three stores of the logged-in user's shard concurrently
+void startLoading() {
+    notes.loader = thread(loadNotes);
+    tasks.loader = thread(loadTasks);
+    contacts.loader = thread(loadContacts);
+}
+
+// Wait for a store's background load, or load it now if never started
+template <typename T>
+static void waitLoaded(RecordStore<T>& s, void (*load)()) {
+    if (s.loader.joinable()) s.loader.join();
+    if (!s.loaded) load();
+}
+void waitNotes() { waitLoaded(notes, loadNotes); }
+void waitTasks() { waitLoaded(tasks, loadTasks); }
+void waitContacts() { waitLoaded(contacts, loadContacts); }
+
+//-------- Notes format ---------
+// File block format (notes.txt):
+// DATE: dd/mm/yyyy hh:mm
+// CONTENT:
+// <line1>
+// <line2>
+// ~
+// ---
+// Deleting the note with id n appends a "#DEL n" line.
+
+//compacting notes: only live notes are written, in the background
+void rewriteNotesFile() {
+    STAT_TIME(STAT_REWRITE_NOTES);
+    if (compactLog(notes)) notes.byTime.prune(notes.liveSeqs());
+}
+
+//loading notes: from the snapshot when current, else replays the log
+void loadNotes() {
+    STAT_TIME(STAT_LOAD_NOTES);
+    logWait(notes.log);
+    notes.clear();
+    packedNotes.clear();
+    notes.loaded = true;
+    notes.log.path = NOTES_FILE;
+    notes.log.adds = notes.log.skipped = notes.log.ops = 0;
+    readHistory(notes, NOTES_UNDO);
+    if (!loadSnapshot(notes, NOTES_FILE, NOTES_SNAPSHOT))
+        loadLog(notes, notes.map(NOTES_FILE), parseRecords<Note>, recordBoundary<Note>);
+    notes.byTime.build(notes.items);
+    openNoteIndex();
+    startHistory(notes);
+    if (needsCompaction(notes)) rewriteNotesFile();
+}
+
+//adding notes
+void appendNoteToFile(Note& n) {
+    STAT_TIME(STAT_APPEND_NOTE);
+    n.seq = notes.log.adds++;
+    string out;
+    formatRecord(out, n, false, notes.dateOf(n));
+    logAppend(notes.log, out);
+}
+
+//save and index a filled-in note (strings already in the arena)
+const Note& storeNote(Note n) {
+    appendNoteToFile(n); // assigns n.seq
+    notes.add(n);
+    notes.byTime.add(n.created, n.seq);
+    noteIndex.add(n.seq, n.content);
+    return notes[notes.size() - 1];
+}
+
+//create a note stamped now (content is newline-terminated lines)
+const Note& insertNote(string_view content) {
+    Note n;
+    n.created = currentMinute();
+    n.oddDate = 0;
+    n.content = notes.keep(content);
+    return storeNote(n);
+}
+
+//delete the note at position i; the caller decides when to compact.
+//The search and date indexes drop it at the next compaction.
+void removeNote(size_t i) {
+    logOp(notes.log, "#DEL", notes[i].seq);
+    notes.erase(i);
+}
+
+//delete the notes created before t; returns how many
+size_t removeNotesBefore(int64_t t) {
+    return removeBefore(notes, t);
+}
+
+void removeAllNotes() {
+    // undo can bring them back, and a pending compaction still reads
+    // their text (waiting for it would stall a daemon's readers): either
+    // way they stay as dead slots until the next compaction
+    if (notes.history.tracking || logCompacting(notes.log)) {
+        removeWhere(notes, [](const Note&, bool) { return true; });
+        return;
+    }
+    notes.clear();
+    packedNotes.clear();
+    noteIndex.clear();
+    rewriteNotesFile(); // swaps in an empty log
+}
+
+// -------------------- Tasks I/O -------------------------
+// File single-line format (tasks.txt):
+// [0] task text | dd/mm/yyyy hh:mm
+// [0]+2 task text | due dd/mm/yyyy hh:mm | p1 | dd/mm/yyyy hh:mm
+// The due date and priority fields are only written when set, and a
+// line with n of them opens "[d]+n"; lines without it are never read
+// for tags, whatever their text ends in. Older versions read the tags
+// (and the "+n") as part of the text. Toggling / deleting the
+// task with id n appends "#TGL n" / "#DEL n", and changing its due
+// date or priority appends "#DUE n dd/mm/yyyy hh:mm pN" ("-" for none).
+
+//compacting tasks: only live tasks are written, in the background
+void rewriteTasksFile() {
+    STAT_TIME(STAT_REWRITE_TASKS);
+    if (compactLog(tasks)) tasks.byTime.prune(tasks.liveSeqs());
+}
+
+//loading saved tasks: from the snapshot when current, else replays the log
+void loadTasks() {
+    STAT_TIME(STAT_LOAD_TASKS);
+    logWait(tasks.log);
+    tasks.clear();
+    tasks.loaded = true;
+    tasks.log.path = TASKS_FILE;
+    tasks.log.adds = tasks.log.skipped = tasks.log.ops = 0;
+    readHistory(tasks, TASKS_UNDO);
+    if (!loadSnapshot(tasks, TASKS_FILE, TASKS_SNAPSHOT))
+        loadLog(tasks, tasks.map(TASKS_FILE), parseRecords<Task>, recordBoundary<Task>);
+    tasks.byTime.build(tasks.items);
+    taskSchedule.build(tasks);
+    startHistory(tasks);
+    if (needsCompaction(tasks)) rewriteTasksFile();
+}
+
+//adding tasks 
+void appendTaskToFile(Task& t, bool done) {
+    STAT_TIME(STAT_APPEND_TASK);
+    t.seq = tasks.log.adds++;
+    string out;
+    formatRecord(out, t, done, tasks.dateOf(t));
+    logAppend(tasks.log, out);
+}
+
+//save and index a filled-in task (strings already in the arena)
+const Task& storeTask(Task t, bool done) {
+    appendTaskToFile(t, done); // assigns t.seq
+    tasks.add(t, done);
+    tasks.byTime.add(t.created, t.seq);
+    taskSchedule.set(t, done);
+    return tasks[tasks.size() - 1];
+}
+
+//create a task stamped now
+const Task& insertTask(string_view text) {
+    Task t;
+    t.text = tasks.keep(text);
+    t.created = currentMinute(); // saved at creation
+    t.oddDate = 0;
+    return storeTask(t, false);
+}
+
+bool taskDateOk(string_view date) {
+    if (date.find_first_of("\r\n") != string_view::npos) return false;
+    return (" | " + string(date)).rfind(" | ") == 0;
+}
+
+//toggle / delete the task at position i; the caller decides when to compact
+void toggleTask(size_t i) {
+    tasks.flipDone(i);
+    logOp(tasks.log, "#TGL", tasks[i].seq);
+    taskSchedule.set(tasks[i], tasks.isDone(i));
+}
+
+void removeTask(size_t i) {
+    logOp(tasks.log, "#DEL", tasks[i].seq);
+    taskSchedule.remove(tasks[i].seq);
+    tasks.erase(i);
+}
+
+//delete all completed tasks / the tasks created before t; return how many
+size_t removeDoneTasks() {
+    return removeWhere(tasks, [](const Task&, bool done) { return done; });
+}
+
+size_t removeTasksBefore(int64_t t) {
+    return removeBefore(tasks, t);
+}
+
+//due date text: dd/mm/yyyy hh:mm, a day (due at 23:59) or "-" for none
+bool parseDue(string_view s, int64_t& t) {
+    int64_t first, last;
+    uint32_t m;
+    if (s == "-") t = NO_TIME;
+    else if (parseDateTime(s, t)) {}
+    else if (parseDay(s, first, last)) t = last - 59;
+    else return false;
+    return dueMinutes(t, m);
+}
+
+string dueOp(uint32_t seq, uint32_t due, uint8_t priority) {
+    string op = "#DUE " + to_string(seq) + " " + (due ? formatDateTime(int64_t(due) * 60) : string("-")) + " p";
+    op += char('0' + priority);
+    op += '\n';
+    return op;
+}
+
+//set task i's due date and priority; appends one "#DUE" line
+bool scheduleTask(size_t i, int64_t due, uint8_t priority) {
+    uint32_t m;
+    if (priority > 3 || !dueMinutes(due, m)) return false;
+    Task& t = tasks[i];
+    if (tasks.history.tracking) tasks.history.edits.push_back({t.seq, t.due, m, t.priority, priority});
+    t.due = m;
+    t.priority = priority;
+    logAppend(tasks.log, dueOp(t.seq, m, priority));
+    tasks.log.ops++;
+    taskSchedule.set(t, tasks.isDone(i));
+    return true;
+}
+
+// -------------------- Contacts I/O ----------------------
+// File block format (contacts.txt):
+// NAME: name
+// PHONE: phone
+// DATE: dd/mm/yyyy hh:mm
+// ---
+// Deleting the contact with id n appends a "#DEL n" line.
+
+//compacting contacts: only live contacts are written, in the background
+void rewriteContactsFile() {
+    STAT_TIME(STAT_REWRITE_CONTACTS);
+    if (compactLog(contacts)) contacts.byTime.prune(contacts.liveSeqs());
+}
+//loading contacts: from the snapshot when current, else replays the log
+void loadContacts() {
+    STAT_TIME(STAT_LOAD_CONTACTS);
+    logWait(contacts.log);
+    contacts.clear();
+    contacts.loaded = true;
+    contacts.log.path = CONTACTS_FILE;
+    contacts.log.adds = contacts.log.skipped = contacts.log.ops = 0;
+    readHistory(contacts, CONTACTS_UNDO);
+    if (!loadSnapshot(contacts, CONTACTS_FILE, CONTACTS_SNAPSHOT))
+        loadLog(contacts, contacts.map(CONTACTS_FILE), parseRecords<Contact>, recordBoundary<Contact>);
+    contacts.byTime.build(contacts.items);
+    buildContactIndex();
+    startHistory(contacts);
+    if (needsCompaction(contacts)) rewriteContactsFile();
+}
+//adding contacts
+void appendContactToFile(Contact& c) {
+    STAT_TIME(STAT_APPEND_CONTACT);
+    c.seq = contacts.log.adds++;
+    string out;
+    formatRecord(out, c, false, contacts.dateOf(c));
+    logAppend(contacts.log, out);
+}
+
+//save and index a filled-in contact (strings already in the arena)
+const Contact& storeContact(Contact c) {
+    appendContactToFile(c); // assigns c.seq
+    contacts.add(c);
+    contacts.byTime.add(c.created, c.seq);
+    contactIndex.add(c);
+    return contacts[contacts.size() - 1];
+}
+
+//create a contact stamped now
+const Contact& insertContact(string_view name, string_view phone) {
+    Contact c;
+    c.name = contacts.keep(name);
+    c.phone = contacts.keep(phone);
+    c.created = currentMinute();
+    c.oddDate = 0;
+    return storeContact(c);
+}
+
+//delete the contact at position i; the caller decides when to compact
+void removeContact(size_t i) {
+    logOp(contacts.log, "#DEL", contacts[i].seq);
+    contactIndex.remove(contacts[i]);
+    contacts.erase(i);
+}
+
+//delete the contacts created before t; returns how many
+size_t removeContactsBefore(int64_t t) {
+    return removeBefore(contacts, t);
+}
+
+void removeAllContacts() {
+    // as removeAllNotes: dead slots while undo or a compaction needs them
+    if (contacts.history.tracking || logCompacting(contacts.log)) {
+        removeWhere(contacts, [](const Contact&, bool) { return true; });
+        return;
+    }
+    contacts.clear();
+    contactIndex.clear();
+    rewriteContactsFile(); // swaps in an empty log
+}
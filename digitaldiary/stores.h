@@ -0,0 +1,295 @@
+#pragma once
+
+#include "codec.h"
+#include "indexes.h"
+#include "schema.h"
+
+// ------- In-memory storage ----------
+extern RecordStore<Note> notes;
+extern RecordStore<Task> tasks;
+extern RecordStore<Contact> contacts;
+extern NoteIndex noteIndex;
+extern ContactIndex contactIndex;
+extern TaskSchedule taskSchedule;
+// the three store logs, for work done on all of them
+extern StoreLog* const storeLogs[3];
+
+// ------------------- Parallel Loading -------------------
+// Run body(0..n-1) on a small pool of worker threads
+void parallelFor(size_t n, const function<void(size_t)>& body);
+// Load all three stores of the logged-in user's shard concurrently
+void startLoading();
+// Wait for a store's background load (or load it now)
+void waitNotes();
+void waitTasks();
+void waitContacts();
+
+// -------------------- Notes I/O -------------------------
+void rewriteNotesFile();
+void loadNotes();
+void appendNoteToFile(Note& n);
+// Add / remove a note in memory, its indexes and notes.txt
+const Note& storeNote(Note n);
+const Note& insertNote(string_view content);
+void removeNote(size_t i);
+size_t removeNotesBefore(int64_t t);
+void removeAllNotes();
+// -------------------- Tasks I/O -------------------------
+void rewriteTasksFile();
+void loadTasks();
+void appendTaskToFile(Task& t, bool done);
+// Add / toggle / remove a task in memory, its index and tasks.txt
+const Task& storeTask(Task t, bool done);
+const Task& insertTask(string_view text);
+// false if a task date would not read back as itself: the date is all
+// after the line's last " | ", so it cannot hold one or start with "| "
+bool taskDateOk(string_view date);
+void toggleTask(size_t i);
+void removeTask(size_t i);
+size_t removeDoneTasks();
+size_t removeTasksBefore(int64_t t);
+// Parse a due date: dd/mm/yyyy hh:mm, dd/mm/yyyy (end of that day) or - for none
+bool parseDue(string_view s, int64_t& t);
+// Set the due date (NO_TIME: none) and priority (0-3) of the task at i
+bool scheduleTask(size_t i, int64_t due, uint8_t priority);
+// The "#DUE" line giving task seq a due date (minutes, 0 none) and priority
+string dueOp(uint32_t seq, uint32_t due, uint8_t priority);
+// -------------------- Contacts I/O ----------------------
+void rewriteContactsFile();
+void loadContacts();
+void appendContactToFile(Contact& c);
+// Add / remove a contact in memory, its indexes and contacts.txt
+const Contact& storeContact(Contact c);
+const Contact& insertContact(string_view name, string_view phone);
+void removeContact(size_t i);
+size_t removeContactsBefore(int64_t t);
+void removeAllContacts();
+
+// Compaction pays off once the log carries more dead weight
+// (tombstoned adds plus op lines) than live records. After a failed
+// compaction the count restarted but the file kept its dead weight, so
+// it is tried again once COMPACT_MIN more dead entries have piled up.
+template <typename T>
+bool needsCompaction(const RecordStore<T>& s) {
+    size_t dead = s.log.adds - s.log.skipped - s.size() + s.log.ops;
+    if (s.log.compactFailed && dead >= COMPACT_MIN) return true;
+    return dead >= COMPACT_MIN && dead > s.size() * COMPACT_RATIO;
+}
+
+// toggle hook used when replaying #TGL (only tasks have a done flag)
+inline void applyToggle(RecordStore<Task>& s, size_t i) { s.flipDone(i); }
+template <typename T> void applyToggle(RecordStore<T>&, size_t) {}
+
+// #DUE hook used when replaying (only tasks have a schedule)
+inline void applySchedule(RecordStore<Task>& s, size_t i, const LogOpRef& o) {
+    s[i].due = o.due;
+    s[i].priority = o.priority;
+}
+template <typename T> void applySchedule(RecordStore<T>&, size_t, const LogOpRef&) {}
+
+// Live records of a store frozen for compaction. The fixed-size records
+// are copied, their text is not: it stays put in the store's arena and
+// mapped files, which are only dropped after logWait.
+template <typename T>
+struct StoreImage {
+    vector<T> items;
+    BitVector done;
+    BitVector dead; // deleted, but kept for undo
+    vector<string_view> oddDates;
+    size_t adds = 0;
+
+    // Compacted log text: the records in id order, with "#SEQ n"
+    // wherever deleted records leave a gap in the ids (and at the end,
+    // so the ids of deleted records are never handed out again), then
+    // a "#DEL n" for each record kept for undo
+    string format() const {
+        string out, gone;
+        size_t next = 0;
+        for (size_t k = 0; k < items.size(); ++k) {
+            const T& r = items[k];
+            if (r.seq != next) out += "#SEQ " + to_string(r.seq) + "\n";
+            formatRecord(out, r, done.test(k), recordDate(r, oddDates));
+            if (dead.test(k)) gone += "#DEL " + to_string(r.seq) + "\n";
+            next = r.seq + 1;
+        }
+        if (next != adds) out += "#SEQ " + to_string(adds) + "\n";
+        out += gone;
+        return out;
+    }
+};
+
+// Freeze the live records of s for compacting its log (dropping its
+// dead slots first); the log's dead weight counts from here on. Records
+// kept for undo are not counted: compacting again would keep them too.
+template <typename T>
+StoreImage<T> freezeLive(RecordStore<T>& s) {
+    s.vacuum();
+    StoreImage<T> img;
+    img.items = s.items;
+    img.done = s.done;
+    img.dead = s.dead;
+    img.oddDates = s.oddDates;
+    img.adds = s.log.adds;
+    s.log.skipped = s.log.adds - s.size();
+    s.log.ops = 0;
+    return img;
+}
+
+// Queue a compaction of s's log; false if one is already pending
+template <typename T>
+bool compactLog(RecordStore<T>& s) {
+    if (logCompacting(s.log)) return false;
+    logCompact(s.log, [img = freezeLive(s)]() { return img.format(); });
+    return true;
+}
+
+// unindex hook for bulk deletes: the contact lookup index and the task
+// schedule are kept exact, the search and date indexes skip deleted
+// records until they are pruned
+inline void unindexRecord(const Contact& c) { contactIndex.remove(c); }
+inline void unindexRecord(const Task& t) { taskSchedule.remove(t.seq); }
+template <typename T> void unindexRecord(const T&) {}
+
+// Delete every record for which drop(record, done) is true in a single
+// pass, with one append carrying all the tombstones. Returns how many
+// went; the caller decides when to compact.
+template <typename T, typename P>
+size_t removeWhere(RecordStore<T>& s, P drop) {
+    string entries;
+    size_t n = s.eraseIf(drop, [&](const T& r) {
+        entries += "#DEL ";
+        entries += to_string(r.seq);
+        entries += '\n';
+        unindexRecord(r);
+    });
+    if (n) {
+        logAppend(s.log, entries);
+        s.log.ops += n;
+    }
+    return n;
+}
+
+// delete the records created before t (those with odd dates stay)
+template <typename T>
+size_t removeBefore(RecordStore<T>& s, int64_t t) {
+    return removeWhere(s, [t](const T& r, bool) { return r.created != NO_TIME && r.created < t; });
+}
+
+// reindex hook for the records (slots) undo brings back, the inverse
+// of unindexRecord; the date index is restored by the caller
+inline void reindexRecords(RecordStore<Note>& s, const vector<size_t>& slots) {
+    vector<pair<uint32_t, string_view>> back;
+    for (size_t k : slots) back.emplace_back(s.items[k].seq, noteText(s.items[k]));
+    noteIndex.restore(back);
+}
+inline void reindexRecords(RecordStore<Task>& s, const vector<size_t>& slots) {
+    for (size_t k : slots) taskSchedule.set(s.items[k], false);
+}
+inline void reindexRecords(RecordStore<Contact>& s, const vector<size_t>& slots) {
+    for (size_t k : slots) contactIndex.add(s.items[k]);
+}
+
+// toggle hook used when undoing (only tasks have a done flag)
+inline void undoToggle(RecordStore<Task>& s, size_t i) {
+    s.flipDone(i);
+    taskSchedule.set(s[i], s.isDone(i));
+}
+template <typename T> void undoToggle(RecordStore<T>&, size_t) {}
+
+// edit hook used when undoing (only tasks have due dates)
+inline void applyEdit(RecordStore<Task>& s, const StoreHistory::Edit& e, bool redo, string& ops) {
+    size_t k = s.slotOfSeq(e.seq);
+    if (k == SIZE_MAX || s.dead.test(k)) return; // as replaying #DUE would
+    Task& t = s.items[k];
+    t.due = redo ? e.dueAfter : e.dueBefore;
+    t.priority = redo ? e.priorityAfter : e.priorityBefore;
+    ops += dueOp(t.seq, t.due, t.priority);
+    taskSchedule.set(t, s.done.test(k));
+}
+template <typename T> void applyEdit(RecordStore<T>&, const StoreHistory::Edit&, bool, string&) {}
+
+// Close an undo step: the changes since the last one become a step
+// named label (none if nothing changed). A new step clears the redo
+// list, and the oldest step goes once there are more than undoDepth.
+template <typename T>
+void recordUndo(RecordStore<T>& s, string_view label) {
+    StoreHistory& h = s.history;
+    if (!h.tracking || (h.now.live.same(h.saved.live) && h.now.done.same(h.saved.done) && h.edits.empty())) return;
+    h.undo.push_back(StoreHistory::Step{string(label), h.saved, h.now, move(h.edits)});
+    h.edits.clear();
+    h.saved = h.now;
+    h.redo.clear();
+    while (h.undo.size() > undoDepth) h.undo.pop_front();
+}
+
+// Undo (or redo) one step: bring back or delete the records whose live
+// bit differs from the version on the other side of it, toggle those
+// whose done bit differs and restore the edits, with one log append.
+// The store then is that version, so history.now takes its sets (and
+// shares their nodes) rather than being updated record by record.
+// label gets the step's name; false if there is nothing to undo.
+template <typename T>
+bool stepUndo(RecordStore<T>& s, bool redo, string& label) {
+    StoreHistory& h = s.history;
+    recordUndo(s, "Other changes");
+    deque<StoreHistory::Step>& from = redo ? h.redo : h.undo;
+    if (from.empty()) return false;
+    StoreHistory::Step step = move(from.back());
+    from.pop_back();
+    const StoreHistory::Version& to = redo ? step.after : step.before;
+    StoreHistory::Version now = to;
+    string ops;
+    size_t count = 0;
+    vector<uint32_t> ids;
+    vector<size_t> back;
+    vector<pair<int64_t, size_t>> times;
+    h.tracking = false;
+    PersistentBits::diff(h.now.live, to.live, ids);
+    for (uint32_t seq : ids) {
+        size_t k = s.slotOfSeq(seq);
+        if (k == SIZE_MAX) { // dropped before it could be kept
+            now.live = now.live.with(seq, false);
+            continue;
+        }
+        if (to.live.test(seq)) {
+            s.revive(k);
+            back.push_back(k);
+            times.emplace_back(s.items[k].created, seq);
+            ops += "#RES ";
+        } else {
+            unindexRecord(s.items[k]);
+            s.erase(s.live.rank(k));
+            ops += "#DEL ";
+        }
+        ops += to_string(seq);
+        ops += '\n';
+        ++count;
+    }
+    s.byTime.restore(times);
+    reindexRecords(s, back);
+    // done records just erased differ here too; they are skipped
+    ids.clear();
+    PersistentBits::diff(h.now.done, to.done, ids);
+    for (uint32_t seq : ids) {
+        size_t i = s.indexOfSeq(seq);
+        if (i == SIZE_MAX) {
+            if (to.done.test(seq)) now.done = now.done.with(seq, false);
+            continue;
+        }
+        undoToggle(s, i);
+        ops += "#TGL " + to_string(seq) + "\n";
+        ++count;
+    }
+    if (redo) for (const auto& e : step.edits) applyEdit(s, e, true, ops);
+    else for (auto e = step.edits.rbegin(); e != step.edits.rend(); ++e) applyEdit(s, *e, false, ops);
+    count += step.edits.size();
+    if (!ops.empty()) {
+        logAppend(s.log, ops);
+        s.log.ops += count;
+    }
+    h.tracking = true;
+    h.now = h.saved = now;
+    label = step.label;
+    (redo ? h.undo : h.redo).push_back(move(step));
+    return true;
+}
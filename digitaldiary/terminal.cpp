@@ -0,0 +1,385 @@
+#include "terminal.h"
+
+// ----------------------- Terminal -----------------------
+bool termInteractive() {
+    const char* term = getenv("TERM");
+    if (term && strcmp(term, "dumb") == 0) return false;
+#ifdef _WIN32
+    return _isatty(_fileno(stdin)) && _isatty(_fileno(stdout));
+#else
+    return term && isatty(STDIN_FILENO) && isatty(STDOUT_FILENO);
+#endif
+}
+
+#ifdef _WIN32
+// _getch already reads single keys without echo
+void termRaw(bool) {}
+
+int readKey() {
+    int c = _getch();
+    if (c == 0 || c == 224) {
+        switch (_getch()) {
+            case 72: return KEY_UP;
+            case 80: return KEY_DOWN;
+            case 75: return KEY_LEFT;
+            case 77: return KEY_RIGHT;
+            case 73: return KEY_PGUP;
+            case 81: return KEY_PGDN;
+            case 71: return KEY_HOME;
+            case 79: return KEY_END;
+            default: return 0;
+        }
+    }
+    if (c == 27) return KEY_ESC;
+    return c == '\r' ? '\n' : c;
+}
+
+void termSize(size_t& rows, size_t& cols) {
+    rows = 24, cols = 80;
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    if (!GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info)) return;
+    rows = info.srWindow.Bottom - info.srWindow.Top + 1;
+    cols = info.srWindow.Right - info.srWindow.Left + 1;
+}
+
+// _getch reads the console even when stdin is redirected
+bool readSecret(const char* prompt, string& out) {
+    if (!_isatty(_fileno(stderr))) return false;
+    cerr << prompt << flush;
+    out.clear();
+    for (int c; (c = _getch()) != '\r' && c != '\n';) {
+        if (c == 3 || c == 26) { cerr << "\n"; return false; } // Ctrl-C, Ctrl-Z
+        if (c == 8) { if (!out.empty()) out.pop_back(); }
+        else out += (char)c;
+    }
+    cerr << "\n";
+    return true;
+}
+#else
+static termios savedTermios;
+static bool termIsRaw = false;
+
+static void termRestore() {
+    if (termIsRaw) tcsetattr(STDIN_FILENO, TCSAFLUSH, &savedTermios);
+    termIsRaw = false;
+}
+
+// Ctrl-C arrives as a key while raw, so the pager can restore the terminal
+void termRaw(bool on) {
+    if (!on) { termRestore(); return; }
+    if (termIsRaw || tcgetattr(STDIN_FILENO, &savedTermios) != 0) return;
+    static bool hooked = false;
+    if (!hooked) { atexit(termRestore); hooked = true; }
+    termios raw = savedTermios;
+    raw.c_lflag &= ~(ICANON | ECHO | ISIG);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    termIsRaw = tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) == 0;
+}
+
+// next input byte, or -1 if none comes within waitMs (-1: wait for ever)
+static int readByte(int waitMs) {
+    pollfd p{STDIN_FILENO, POLLIN, 0};
+    if (waitMs >= 0 && poll(&p, 1, waitMs) <= 0) return -1;
+    unsigned char c;
+    ssize_t n;
+    while ((n = read(STDIN_FILENO, &c, 1)) < 0 && errno == EINTR) {}
+    return n == 1 ? c : -1;
+}
+
+int readKey() {
+    int c = readByte(-1);
+    if (c < 0) return KEY_EOF;
+    if (c == '\r') return '\n';
+    if (c != 27) return c;
+    // a lone Esc, or the start of an ESC [ / ESC O key sequence
+    int kind = readByte(30);
+    if (kind != '[' && kind != 'O') return KEY_ESC;
+    int num = 0, last;
+    while ((last = readByte(30)) >= '0' && last <= '9') num = num * 10 + (last - '0');
+    while (last == ';' || (last >= '0' && last <= '9')) last = readByte(30); // modifiers
+    switch (last) {
+        case 'A': return KEY_UP;
+        case 'B': return KEY_DOWN;
+        case 'C': return KEY_RIGHT;
+        case 'D': return KEY_LEFT;
+        case 'H': return KEY_HOME;
+        case 'F': return KEY_END;
+        case '~':
+            if (num == 5) return KEY_PGUP;
+            if (num == 6) return KEY_PGDN;
+            if (num == 1 || num == 7) return KEY_HOME;
+            if (num == 4 || num == 8) return KEY_END;
+            return 0;
+        default: return 0;
+    }
+}
+
+// echo stays off only while the key is typed; a key is never read
+// from a terminal that could not turn echo off
+bool readSecret(const char* prompt, string& out) {
+    int fd = open("/dev/tty", O_RDWR | O_CLOEXEC);
+    if (fd < 0) return false;
+    termios saved, quiet;
+    if (tcgetattr(fd, &saved) != 0) { ::close(fd); return false; }
+    quiet = saved;
+    quiet.c_lflag &= ~ECHO;
+    if (tcsetattr(fd, TCSAFLUSH, &quiet) != 0) { ::close(fd); return false; }
+    ssize_t n = write(fd, prompt, strlen(prompt));
+    out.clear();
+    char c;
+    while ((n = read(fd, &c, 1)) == 1 || (n < 0 && errno == EINTR))
+        if (n == 1 && c == '\n') break;
+        else if (n == 1) out += c;
+    tcsetattr(fd, TCSAFLUSH, &saved);
+    if (write(fd, "\n", 1) < 0) {} // the typed newline was not echoed
+    ::close(fd);
+    if (!out.empty() && out.back() == '\r') out.pop_back();
+    return n == 1;
+}
+
+void termSize(size_t& rows, size_t& cols) {
+    rows = 24, cols = 80;
+    winsize w;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &w) == 0 && w.ws_row && w.ws_col) rows = w.ws_row, cols = w.ws_col;
+}
+#endif
+
+// ---------------------- Screen Model ---------------------
+void Screen::resize(size_t rows, size_t cols) {
+    // one column spare: writing the last one makes some consoles wrap
+    cols = cols > 1 ? cols - 1 : 1;
+    if (rows == height && cols == width) return;
+    height = rows, width = cols;
+    front.assign(height * width, Cell());
+    fresh = true;
+}
+
+uint16_t Screen::attrId(const string& sgr) {
+    auto it = attrIds.find(sgr);
+    if (it != attrIds.end()) return it->second;
+    if (attrs.size() > UINT16_MAX) return 0;
+    attrs.push_back(sgr);
+    return attrIds[sgr] = (uint16_t)(attrs.size() - 1);
+}
+
+// Lay text out on back from row on, stopping after lastRow. Colour
+// escapes change sgr (the SGR parameters in effect), other escapes are
+// dropped, tabs go to the next multiple of 8 and lines longer than the
+// screen are cut. Returns the row after the last one written.
+size_t Screen::layout(string_view text, size_t row, size_t lastRow, string& sgr) {
+    size_t col = 0;
+    uint16_t attr = attrId(sgr);
+    for (size_t i = 0; i < text.size() && row <= lastRow; ) {
+        unsigned char c = (unsigned char)text[i];
+        if (c == '\033' && i + 1 < text.size() && text[i + 1] == '[') {
+            size_t j = i + 2;
+            while (j < text.size() && !(text[j] >= 0x40 && text[j] <= 0x7e)) ++j;
+            if (j < text.size() && text[j] == 'm') {
+                string_view p = text.substr(i + 2, j - i - 2);
+                if (p.empty() || p == "0") sgr.clear();
+                else if (p.substr(0, 2) == "0;") sgr = string(p.substr(2));
+                else sgr += (sgr.empty() ? "" : ";") + string(p);
+                attr = attrId(sgr);
+            }
+            i = j + 1;
+            continue;
+        }
+        if (c == '\n') { ++row; col = 0; caretRow = row; caretCol = 0; ++i; continue; }
+        size_t len = 1;
+        if (c >= 0xc0) while (len < 4 && i + len < text.size() && ((unsigned char)text[i + len] & 0xc0) == 0x80) ++len;
+        if (c == '\t') {
+            size_t to = min(width, (col / 8 + 1) * 8);
+            while (col < to) { Cell& cell = back[row * width + col++]; cell = Cell(); cell.attr = attr; }
+        } else if (c >= 0x20 && c != 0x7f && col < width) {
+            Cell& cell = back[row * width + col++];
+            memcpy(cell.ch, text.data() + i, len);
+            cell.len = (uint8_t)len;
+            cell.attr = attr;
+        }
+        caretRow = row, caretCol = col;
+        i += len;
+    }
+    return col ? row + 1 : row;
+}
+
+string Screen::draw(string_view body, string_view status) {
+    string out;
+    if (!height || !width) return out;
+    back.assign(height * width, Cell());
+    size_t statusLines = 0;
+    for (char c : status) statusLines += c == '\n';
+    if (!status.empty() && status.back() != '\n') ++statusLines;
+    statusLines = min(statusLines, height);
+    string sgr;
+    caretRow = caretCol = 0;
+    size_t row = height > statusLines ? layout(body, 0, height - statusLines - 1, sgr) : 0;
+    sgr.clear();
+    layout(status, min(row, height - statusLines), height - 1, sgr);
+    if (caretRow >= height) caretRow = height - 1;
+
+    if (fresh) {
+        out += "\033[0m\033[H\033[2J";
+        front.assign(height * width, Cell());
+        fresh = false;
+    }
+    // walk the changed cells; a short run of unchanged cells in between
+    // is written again when that is cheaper than moving the cursor
+    size_t curRow = SIZE_MAX, curCol = 0;
+    uint16_t curAttr = 0;
+    for (size_t r = 0; r < height; ++r) {
+        for (size_t c = 0; c < width; ++c) {
+            const Cell& cell = back[r * width + c];
+            if (cell == front[r * width + c]) continue;
+            if (r == curRow && c > curCol && c - curCol <= 6) {
+                size_t k = curCol;
+                while (k < c && back[r * width + k].attr == curAttr) ++k;
+                if (k == c) for (k = curCol; k < c; ++k) out.append(back[r * width + k].ch, back[r * width + k].len);
+                else out += "\033[" + to_string(r + 1) + ";" + to_string(c + 1) + "H";
+            }
+            else if (r != curRow || c != curCol) out += "\033[" + to_string(r + 1) + ";" + to_string(c + 1) + "H";
+            if (cell.attr != curAttr) {
+                out += "\033[0";
+                if (cell.attr) out += ";" + attrs[cell.attr];
+                out += 'm';
+                curAttr = cell.attr;
+            }
+            out.append(cell.ch, cell.len);
+            curRow = r, curCol = c + 1;
+        }
+    }
+    if (curAttr) out += "\033[0m";
+    out += "\033[" + to_string(caretRow + 1) + ";" + to_string(min(caretCol, width - 1) + 1) + "H";
+    front.swap(back);
+    return out;
+}
+
+string Screen::leave() {
+    fresh = true;
+    return "\033[0m\n";
+}
+
+// -------------------- Paged Output ----------------------
+size_t pageSize = PAGE_SIZE; // changed from the pager with "s N"
+
+// Write a formatted buffer to the console with a single write
+void writeOut(const string& buf) {
+    cout.flush();
+    fwrite(buf.data(), 1, buf.size(), stdout);
+    fflush(stdout);
+}
+
+void padRight(string& out, string_view s, size_t width) {
+    out += s;
+    if (s.size() < width) out.append(width - s.size(), ' ');
+}
+
+void padLeft(string& out, string_view s, size_t width) {
+    if (s.size() < width) out.append(width - s.size(), ' ');
+    out += s;
+}
+
+// Pager on a terminal: keys act without Enter and every page goes
+// through a Screen, so turning a page writes only the cells that
+// differ from the one before (the header and most of the footer stay)
+static void pagedViewTerm(StatOp stat, size_t count, const function<void(string&)>& header,
+                          const function<void(string&, size_t)>& row) {
+    (void)stat;
+    Screen screen;
+    size_t page = 0;
+    string body, status, number;
+    char asking = 0; // 'j' or 's' while a number is being typed
+    termRaw(true);
+    while (true) {
+        size_t rows, cols;
+        termSize(rows, cols);
+        screen.resize(rows, cols);
+        size_t pages = (count + pageSize - 1) / pageSize;
+        if (page >= pages) page = pages - 1;
+        size_t from = page * pageSize, to = min(count, from + pageSize);
+        {
+            STAT_TIME(stat);
+            body.clear();
+            header(body);
+            for (size_t i = from; i < to; ++i) row(body, i);
+            status = INDENT + "Page " + to_string(page + 1) + "/" + to_string(pages) + "  ("
+                   + to_string(from + 1) + "-" + to_string(to) + " of " + to_string(count) + ")";
+            if ((size_t)count_if(body.begin(), body.end(), [](char c) { return c == '\n'; }) + 2 > screen.rows())
+                status += YELLOW "  cut to fit: s N shows fewer" RESET;
+            status += "\n" + INDENT + YELLOW;
+            if (asking) status += (asking == 'j' ? "Jump to page: " : "Records per page: ") + number;
+            else status += "[n]ext [p]rev [j]ump N [s]ize N [q]uit: ";
+            status += RESET;
+            writeOut(screen.draw(body, status));
+        }
+        int k = readKey();
+        if (asking) {
+            if (k >= '0' && k <= '9' && number.size() < 9) number += (char)k;
+            else if ((k == 127 || k == 8) && !number.empty()) number.pop_back();
+            else if (k == '\n') {
+                size_t v = number.empty() ? 0 : stoul(number);
+                if (asking == 'j') page = v > 1 ? v - 1 : 0;
+                else if (v) { pageSize = v; page = from / pageSize; }
+                asking = 0;
+            }
+            else if (k == KEY_ESC || k == KEY_EOF || k == 3) asking = 0;
+            if (k != KEY_EOF) continue;
+        }
+        if (k == KEY_EOF || k == KEY_ESC || k == 3 || k == 'q' || k == 'Q') break;
+        if (k == 'n' || k == 'N' || k == ' ' || k == KEY_RIGHT || k == KEY_DOWN || k == KEY_PGDN) { if (page + 1 < pages) ++page; }
+        else if (k == 'p' || k == 'P' || k == KEY_LEFT || k == KEY_UP || k == KEY_PGUP) { if (page > 0) --page; }
+        else if (k == KEY_HOME) page = 0;
+        else if (k == KEY_END) page = pages - 1;
+        else if (k == 'j' || k == 'J' || k == 's' || k == 'S') { asking = (char)tolower(k); number.clear(); }
+    }
+    termRaw(false);
+    writeOut(screen.leave());
+}
+
+// Show count records a page at a time. Each page is formatted into one
+// buffer (header, visible rows, footer) and written at once, so the
+// cost of a page depends on the page size, not on count. Lists that
+// fit on one page print without a prompt. Each page counts as one
+// call of stat; the time spent waiting for a command is not included.
+// On a terminal the pager reads single keys (pagedViewTerm); with
+// piped input it reads commands as words.
+void pagedView(StatOp stat, size_t count, const function<void(string&)>& header,
+               const function<void(string&, size_t)>& row) {
+    (void)stat;
+    if (count > pageSize && termInteractive()) {
+        pagedViewTerm(stat, count, header, row);
+        return;
+    }
+    size_t page = 0;
+    string out;
+    while (true) {
+        size_t pages = (count + pageSize - 1) / pageSize;
+        if (page >= pages) page = pages - 1;
+        size_t from = page * pageSize, to = min(count, from + pageSize);
+        {
+            STAT_TIME(stat);
+            out.clear();
+            header(out);
+            for (size_t i = from; i < to; ++i) row(out, i);
+            if (pages > 1) {
+                out += INDENT + "Page " + to_string(page + 1) + "/" + to_string(pages) + "  ("
+                     + to_string(from + 1) + "-" + to_string(to) + " of " + to_string(count) + ")\n";
+                out += INDENT + YELLOW "[n]ext [p]rev [j]ump N [s]ize N [q]uit: " RESET;
+            }
+            writeOut(out);
+        }
+        if (pages <= 1) return;
+        string cmd;
+        if (!(cin >> cmd)) return;
+        char c = (char)tolower((unsigned char)cmd[0]);
+        if (c == 'n') { if (page + 1 < pages) ++page; }
+        else if (c == 'p') { if (page > 0) --page; }
+        else if (c == 'j' || c == 's') {
+            long long v;
+            if (!(cin >> v)) { cin.clear(); continue; }
+            if (c == 'j') page = v > 1 ? (size_t)(v - 1) : 0;
+            else { pageSize = v > 0 ? (size_t)v : 1; page = from / pageSize; }
+        }
+        else if (c == 'q') return;
+    }
+}
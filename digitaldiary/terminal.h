@@ -0,0 +1,66 @@
+#pragma once
+
+#include "common.h"
+
+// ----------------------- Terminal -----------------------
+// keys readKey() returns besides plain characters
+enum Key {
+    KEY_EOF = -1,
+    KEY_UP = 256, KEY_DOWN, KEY_LEFT, KEY_RIGHT,
+    KEY_PGUP, KEY_PGDN, KEY_HOME, KEY_END, KEY_ESC
+};
+// stdin and stdout are both a terminal that understands ANSI
+bool termInteractive();
+// Switch keyboard input to raw mode (keys arrive at once, no echo) and back
+void termRaw(bool on);
+// Wait for one key press
+int readKey();
+// Visible rows and columns of the terminal (24x80 if unknown)
+void termSize(size_t& rows, size_t& cols);
+// Ask for a secret on the controlling terminal (not stdin, which may
+// carry commands) without echoing it; false if there is no terminal
+bool readSecret(const char* prompt, string& out);
+
+// What the terminal shows, as a grid of cells. draw() lays a frame out
+// on the grid and returns only the output needed to change the last
+// frame into it: cursor moves, colour changes and the changed cells.
+class Screen {
+public:
+    // a new size repaints everything on the next draw
+    void resize(size_t rows, size_t cols);
+    // body from the top (cut to fit), then status right below it; the
+    // cursor is left at the end of status
+    string draw(string_view body, string_view status);
+    // leave the last frame on screen and move below it
+    string leave();
+    size_t rows() const { return height; }
+private:
+    struct Cell {
+        char ch[4] = {' '};
+        uint8_t len = 1;
+        uint16_t attr = 0; // index into attrs, 0 = default colours
+        bool operator==(const Cell& o) const {
+            return attr == o.attr && len == o.len && memcmp(ch, o.ch, len) == 0;
+        }
+    };
+    size_t height = 0, width = 0;
+    vector<Cell> front, back; // on the terminal / being laid out
+    bool fresh = true;        // terminal contents unknown
+    size_t caretRow = 0, caretCol = 0;
+    vector<string> attrs{string()}; // SGR parameters of each colour state
+    unordered_map<string, uint16_t> attrIds{{string(), 0}};
+    uint16_t attrId(const string& sgr);
+    size_t layout(string_view text, size_t row, size_t lastRow, string& sgr);
+};
+
+// -------------------- Paged Output ----------------------
+// Records per list page, changed from the pager with "s N"
+extern size_t pageSize;
+// Write a formatted buffer to the console in one go
+void writeOut(const string& buf);
+// Append s padded with spaces to width (left / right aligned)
+void padRight(string& out, string_view s, size_t width);
+void padLeft(string& out, string_view s, size_t width);
+// Page through count records; only rows on the visible page are formatted
+void pagedView(StatOp stat, size_t count, const function<void(string&)>& header,
+               const function<void(string&, size_t)>& row);
@@ -0,0 +1,30 @@
+// Small helpers for the unit tests: CHECK reports a failed condition
+// and carries on, testResult() prints the outcome and is main's exit code.
+#pragma once
+
+#include "common.h"
+
+inline int checkFailures = 0;
+
+#define CHECK(cond)                                                                  \
+    do {                                                                             \
+        if (!(cond)) {                                                               \
+            ++checkFailures;                                                         \
+            cerr << __FILE__ << ":" << __LINE__ << ": CHECK failed: " #cond "\n";    \
+        }                                                                            \
+    } while (0)
+
+inline int testResult(const char* name) {
+    if (checkFailures) cerr << name << ": " << checkFailures << " check(s) failed\n";
+    else cout << name << ": ok\n";
+    return checkFailures ? 1 : 0;
+}
+
+// An empty directory (ending in '/') for a test to write into
+inline string scratchDir(const string& name) {
+    filesystem::path p = filesystem::temp_directory_path() / ("diary_test_" + name);
+    error_code ec;
+    filesystem::remove_all(p, ec);
+    filesystem::create_directories(p, ec);
+    return p.string() + "/";
+}
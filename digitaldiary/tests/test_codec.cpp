@@ -0,0 +1,128 @@
+// LZ block codec: round trips of awkward inputs, and truncated or
+// corrupt blocks failing cleanly. Compressed data is always decoded
+// from a buffer of exactly its size into one of exactly rawSize bytes,
+// so a sanitizer build (DIARY_SANITIZE) catches any read or write
+// past either end.
+#include "check.h"
+#include "codec.h"
+
+// decode in as a block of rawSize bytes; out gets the bytes on success
+static bool inflate(const string& in, size_t rawSize, string& out) {
+    unique_ptr<char[]> packed(new char[max<size_t>(in.size(), 1)]);
+    memcpy(packed.get(), in.data(), in.size());
+    unique_ptr<char[]> raw(new char[max<size_t>(rawSize, 1)]);
+    if (!lzDecompress(string_view(packed.get(), in.size()), raw.get(), rawSize)) return false;
+    out.assign(raw.get(), rawSize);
+    return true;
+}
+
+static bool roundTrip(const string& raw, string* packedOut = nullptr) {
+    string packed, back;
+    lzCompress(raw, packed);
+    if (packedOut) *packedOut = packed;
+    return inflate(packed, raw.size(), back) && back == raw;
+}
+
+static string randomBytes(mt19937& rng, size_t n) {
+    string s(n, '\0');
+    for (char& c : s) c = char(rng());
+    return s;
+}
+
+// note-like text from a small vocabulary, so it compresses
+static string randomText(mt19937& rng, size_t n) {
+    static const char* const words[] = {"diary ", "note ", "meeting ", "call ", "tomorrow ", "\n", "list ", "buy "};
+    string s;
+    while (s.size() < n) s += words[rng() % 8];
+    s.resize(n);
+    return s;
+}
+
+static void testRoundTrips() {
+    mt19937 rng(18);
+    string packed;
+    // empty input is a single empty sequence
+    CHECK(roundTrip("", &packed));
+    CHECK(packed.size() == 1);
+    // shorter than a match
+    CHECK(roundTrip("a"));
+    CHECK(roundTrip("abc"));
+    CHECK(roundTrip("abcd"));
+    // incompressible: may grow, but only by the length bytes
+    string noise = randomBytes(rng, 100000);
+    CHECK(roundTrip(noise, &packed));
+    CHECK(packed.size() <= noise.size() + noise.size() / 255 + 16);
+    // highly repetitive: long overlapping matches
+    string same(1 << 20, 'a');
+    CHECK(roundTrip(same, &packed));
+    CHECK(packed.size() < same.size() / 200);
+    CHECK(roundTrip(string(70000, '\0')));
+    string period;
+    for (int i = 0; i < 50000; ++i) period += "xyz"[i % 3];
+    CHECK(roundTrip(period));
+    // literal runs and matches whose lengths sit on the 15 / 255 steps
+    for (size_t lit : {14, 15, 16, 269, 270, 271}) {
+        for (size_t match : {4, 18, 19, 20, 273, 274, 275}) {
+            string s = randomBytes(rng, lit) + string(match + 1, 'q') + randomBytes(rng, 5);
+            CHECK(roundTrip(s));
+        }
+    }
+    // around PACK_BLOCK, the size of a packed notes.bin block
+    for (size_t n : {PACK_BLOCK - 1, PACK_BLOCK, PACK_BLOCK + 1}) {
+        CHECK(roundTrip(randomText(rng, n)));
+        CHECK(roundTrip(randomBytes(rng, n)));
+    }
+    // repeats just inside and just past the 16-bit match offset
+    for (size_t gap : {65534, 65535, 65536, 65537}) {
+        string head = randomBytes(rng, gap);
+        CHECK(roundTrip(head + head.substr(0, 64)));
+    }
+}
+
+static void testBadBlocks() {
+    mt19937 rng(1818);
+    string raw = randomText(rng, 20000) + randomBytes(rng, 3000) + string(5000, '-'), packed, out;
+    lzCompress(raw, packed);
+    CHECK(inflate(packed, raw.size(), out) && out == raw);
+    // the wrong raw size
+    CHECK(!inflate(packed, raw.size() - 1, out));
+    CHECK(!inflate(packed, raw.size() + 1, out));
+    // every truncation
+    size_t truncatedOk = 0;
+    for (size_t n = 0; n < packed.size(); ++n) truncatedOk += inflate(packed.substr(0, n), raw.size(), out);
+    CHECK(truncatedOk == 0);
+    // hand-made sequences: a match before any output, an offset of 0,
+    // a match running past rawSize, literals past the end of the input,
+    // length bytes cut off, an offset cut off
+    CHECK(!inflate(string("\x00\x01\x00", 3), 4, out));
+    CHECK(!inflate(string("\x10" "a" "\x00\x00", 4), 5, out));
+    CHECK(!inflate(string("\x10" "a" "\x01\x00", 4), 3, out));
+    CHECK(!inflate(string("\x50" "ab", 3), 5, out));
+    CHECK(!inflate(string("\xf0\xff", 2), 300, out));
+    CHECK(!inflate(string("\x10" "a" "\x01", 3), 5, out));
+    // a block must end with a literals-only sequence
+    CHECK(!inflate(string("\x10" "a" "\x01\x00", 4), 5, out));
+    CHECK(!inflate(string("\x10" "a" "\x01\x00\x01", 5), 5, out));
+    CHECK(inflate(string("\x10" "a" "\x01\x00\x00", 5), 5, out) && out == "aaaaa");
+    // flipped bytes and random garbage may decode or not, but must
+    // never touch memory outside the buffers
+    for (int k = 0; k < 2000; ++k) {
+        string bad = packed;
+        for (int f = 0; f <= k % 4; ++f) bad[rng() % bad.size()] ^= char(1 + rng() % 255);
+        inflate(bad, raw.size(), out);
+        inflate(randomBytes(rng, rng() % 64), rng() % 256, out);
+    }
+    // a block that does not inflate reads as empty text
+    PackedText pt;
+    pt.add(packed.data(), (uint32_t)packed.size() - 1, (uint32_t)raw.size());
+    pt.add(packed.data(), (uint32_t)packed.size(), (uint32_t)raw.size());
+    CHECK(pt.text(0).empty());
+    CHECK(pt.text(1) == raw);
+    CHECK(pt.text(2).empty());
+}
+
+int main() {
+    testRoundTrips();
+    testBadBlocks();
+    return testResult("codec");
+}
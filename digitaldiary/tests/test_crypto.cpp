@@ -0,0 +1,89 @@
+// SHA-256 against the FIPS 180 examples, PBKDF2-HMAC-SHA256 against the
+// published vectors for the RFC 6070 inputs, and stored credentials.
+#include "check.h"
+#include "crypto.h"
+
+static string hex(const uint8_t* p, size_t n) {
+    static const char* digits = "0123456789abcdef";
+    string out;
+    for (size_t i = 0; i < n; ++i) { out += digits[p[i] >> 4]; out += digits[p[i] & 15]; }
+    return out;
+}
+
+static string sha256(string_view s) {
+    Sha256 h;
+    h.update(s.data(), s.size());
+    uint8_t out[32];
+    h.finish(out);
+    return hex(out, 32);
+}
+
+// the first n bytes of the derived key, as hex
+static string pbkdf2(string_view key, string_view salt, uint32_t iterations, size_t n = 32) {
+    uint8_t out[32];
+    pbkdf2Sha256(key, salt, iterations, out);
+    return hex(out, n);
+}
+
+static void testSha256() {
+    CHECK(sha256("") == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    CHECK(sha256("abc") == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    const string two = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    CHECK(sha256(two) == "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    const string million(1000000, 'a');
+    CHECK(sha256(million) == "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+    // fed in uneven pieces, including empty ones and across the padding edge
+    for (size_t step : {1, 3, 55, 56, 63, 64, 65, 1000}) {
+        Sha256 h;
+        for (size_t i = 0; i < million.size(); i += step) {
+            h.update(nullptr, 0);
+            h.update(million.data() + i, min(step, million.size() - i));
+        }
+        uint8_t out[32];
+        h.finish(out);
+        CHECK(hex(out, 32) == "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+    }
+}
+
+static void testPbkdf2() {
+    CHECK(pbkdf2("password", "salt", 1) == "120fb6cffcf8b32c43e7225256c4f837a86548c92ccc35480805987cb70be17b");
+    CHECK(pbkdf2("password", "salt", 2) == "ae4d0c95af6b46d32d0adff928f06dd02a303f8ef3c251dfd6e2d85a95474c43");
+    CHECK(pbkdf2("password", "salt", 4096) == "c5e478d59288c841aa530db6845c4c8d962893a001ce4e11a4963873aa98134a");
+    // the 40 and 16 byte vectors share their first block with this 32 byte one
+    CHECK(pbkdf2("passwordPASSWORDpassword", "saltSALTsaltSALTsaltSALTsaltSALTsalt", 4096)
+          == "348c89dbcbd32b2f32d814b8116e84cf2b17347ebc1800181c4e2a1fb8dd53e1");
+    CHECK(pbkdf2(string_view("pass\0word", 9), string_view("sa\0lt", 5), 4096, 16) == "89b69d0516f829893c696226650a8687");
+    // HMAC hashes keys longer than a block first
+    string longKey(100, 'k');
+    Sha256 h;
+    h.update(longKey.data(), longKey.size());
+    uint8_t digest[32];
+    h.finish(digest);
+    CHECK(pbkdf2(longKey, "salt", 3) == pbkdf2(string_view((const char*)digest, 32), "salt", 3));
+    CHECK(pbkdf2(string(64, 'k'), "salt", 3) != pbkdf2(string(65, 'k'), "salt", 3));
+}
+
+static void testCredentials() {
+    string cred = hashKey("secret", 1000), salt, hash;
+    uint32_t iterations = 0;
+    CHECK(parseCredential(cred, iterations, salt, hash));
+    CHECK(iterations == 1000 && salt.size() == 16 && hash.size() == 32);
+    CHECK(checkKey(cred, "secret"));
+    CHECK(!checkKey(cred, "Secret"));
+    CHECK(!checkKey(cred, ""));
+    CHECK(hashKey("secret", 1000) != cred); // fresh salt every time
+    // plain keys from older versions
+    CHECK(checkKey("k1", "k1"));
+    CHECK(!checkKey("k1", "k2"));
+    CHECK(!parseCredential("$pbkdf2-sha256$0$00$" + string(64, '0'), iterations, salt, hash));
+    CHECK(!parseCredential("$pbkdf2-sha256$10$0g$" + string(64, '0'), iterations, salt, hash));
+    CHECK(!parseCredential("$pbkdf2-sha256$10$00$" + string(62, '0'), iterations, salt, hash));
+    CHECK(parseCredential("$pbkdf2-sha256$10$00$" + string(64, '0'), iterations, salt, hash));
+}
+
+int main() {
+    testSha256();
+    testPbkdf2();
+    testCredentials();
+    return testResult("crypto");
+}
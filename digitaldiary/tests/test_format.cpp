@@ -0,0 +1,150 @@
+// Record text format: what formatRecord writes, parseRecords reads back
+#include "check.h"
+#include "batch.h"
+#include "schema.h"
+#include "stores.h"
+#include "transfer.h"
+#include "users.h"
+
+// parse a whole log image as one piece
+template <typename T>
+static ParsedChunk<T> parse(string_view img) {
+    ParsedChunk<T> out;
+    parseRecords(img, out);
+    return out;
+}
+
+static void testNotes() {
+    int64_t t;
+    CHECK(parseDateTime("05/03/2026 09:30", t));
+    Note n{};
+    n.content = "first line\nsecond line\n";
+    n.created = t;
+    string log;
+    formatRecord(log, n, false, "05/03/2026 09:30");
+    CHECK(log == "DATE: 05/03/2026 09:30\nCONTENT:\nfirst line\nsecond line\n~\n---\n");
+    log += "#DEL 0\n";
+    ParsedChunk<Note> p = parse<Note>(log);
+    CHECK(p.clean);
+    CHECK(p.records.size() == 1 && p.records[0].content == n.content && p.records[0].created == t);
+    CHECK(p.ops.size() == 1 && p.ops[0].op == 'D' && p.ops[0].seq == 0 && p.ops[0].addsBefore == 1);
+    // CRLF bodies are copied with plain line ends
+    ParsedChunk<Note> crlf = parse<Note>("DATE: 05/03/2026 09:30\r\nCONTENT:\r\na\r\nb\r\n~\r\n---\r\n");
+    CHECK(crlf.records.size() == 1 && crlf.records[0].content == "a\nb\n");
+    // a note cut off in its body leaves the piece unclean
+    CHECK(!parse<Note>("DATE: 05/03/2026 09:30\nCONTENT:\nhalf").clean);
+}
+
+static void testTasks() {
+    int64_t created, due;
+    CHECK(parseDateTime("01/02/2026 08:00", created) && parseDateTime("03/02/2026 18:45", due));
+    Task t{};
+    t.text = "pay rent";
+    t.created = created;
+    CHECK(dueMinutes(due, t.due));
+    t.priority = 2;
+    string log;
+    formatRecord(log, t, true, "01/02/2026 08:00");
+    CHECK(log == "[1]+2 pay rent | due 03/02/2026 18:45 | p2 | 01/02/2026 08:00\n");
+    Task plain = t;
+    plain.due = 0;
+    plain.priority = 0;
+    formatRecord(log, plain, false, "01/02/2026 08:00");
+    log += "#TGL 1\n#DUE 0 - p3\n";
+    ParsedChunk<Task> p = parse<Task>(log);
+    CHECK(p.records.size() == 2);
+    CHECK(p.records[0].text == "pay rent" && p.records[0].due == t.due && p.records[0].priority == 2 && p.done.test(0));
+    CHECK(p.records[1].text == "pay rent" && !p.records[1].due && !p.records[1].priority && !p.done.test(1));
+    CHECK(p.ops.size() == 2 && p.ops[0].op == 'T' && p.ops[1].op == 'U' && p.ops[1].due == 0 && p.ops[1].priority == 3);
+    // a date that does not parse is kept as text
+    ParsedChunk<Task> odd = parse<Task>("[0] old task | yesterday\n");
+    CHECK(odd.records.size() == 1 && odd.records[0].created == NO_TIME
+          && odd.oddDates[odd.records[0].oddDate] == "yesterday");
+}
+
+// tags are only read from lines marked "[d]+n": typed text and lines
+// of older versions read back as they are, whatever they end in
+static void testTaskText() {
+    const char* texts[] = {"hello", "hello | p1", "call | due 03/02/2026 18:45", "x | p3 | due 03/02/2026 18:45",
+                           "a | b", "| p1", ""};
+    for (const char* text : texts) {
+        for (int tags = 0; tags < 4; ++tags) {
+            Task t{};
+            t.text = text;
+            t.due = (tags & 1) ? 1000 : 0;
+            t.priority = (tags & 2) ? 3 : 0;
+            string log;
+            formatRecord(log, t, false, "01/02/2026 08:00");
+            ParsedChunk<Task> p = parse<Task>(log);
+            CHECK(p.records.size() == 1 && p.records[0].text == text);
+            CHECK(p.records.size() == 1 && p.records[0].due == t.due && p.records[0].priority == t.priority);
+        }
+    }
+    // lines as older versions wrote them keep their whole text
+    ParsedChunk<Task> old = parse<Task>("[0] call mum | p2 | 01/02/2025 10:00\n"
+                                        "[1] meet | due 01/02/2025 10:00 | 01/02/2025 09:00\n");
+    CHECK(old.records.size() == 2);
+    CHECK(old.records[0].text == "call mum | p2" && !old.records[0].priority && !old.records[0].due);
+    CHECK(old.records[1].text == "meet | due 01/02/2025 10:00" && !old.records[1].priority && !old.records[1].due);
+    // a mark without as many tags leaves the text alone
+    ParsedChunk<Task> torn = parse<Task>("[0]+2 pay | p1 | 01/02/2025 10:00\n");
+    CHECK(torn.records.size() == 1 && torn.records[0].text == "pay | p1" && !torn.records[0].priority);
+    // batch "task add" stores the text as typed
+    openShardDir(scratchDir("format_task_add"));
+    string out;
+    size_t errors = 0;
+    CHECK(batchRun("task add hello | p1", out, errors, true));
+    CHECK(tasks.size() == 1 && tasks[0].text == "hello | p1" && !tasks[0].priority && !tasks[0].due);
+    logCommit(tasks.log); // as the end of a batch run
+    closeLogs();
+}
+
+// an imported task date that does not parse is kept as text, so it
+// must not hold the " | " that ends the text on reading
+static void testTaskDates() {
+    for (const char* bad : {"someday | later", "| x", "| ", "a\nb"}) CHECK(!taskDateOk(bad));
+    for (const char* good : {"someday", "x |", "a |b", "|", ""}) {
+        CHECK(taskDateOk(good));
+        Task t{};
+        t.text = "pay | rent";
+        string log;
+        formatRecord(log, t, false, good);
+        ParsedChunk<Task> p = parse<Task>(log);
+        CHECK(p.records.size() == 1 && p.records[0].text == "pay | rent");
+        CHECK(p.records.size() == 1 && p.oddDates[p.records[0].oddDate] == good);
+    }
+    durability = Durability::PerOp; // on disk before the reload
+    openShardDir(scratchDir("format_task_import"));
+    loadTasks();
+    istringstream in("{\"text\":\"pay rent\",\"date\":\"someday | later\"}\n"
+                     "{\"text\":\"pay rent\",\"date\":\"someday\"}\n");
+    size_t errors = 0;
+    CHECK(importTasks(in, "tasks.jsonl", false, errors) == 1 && errors == 1);
+    loadTasks();
+    CHECK(tasks.size() == 1 && tasks[0].text == "pay rent" && tasks.dateOf(tasks[0]) == "someday");
+    closeLogs();
+}
+
+static void testContacts() {
+    Contact c{};
+    c.name = "Ali Khan";
+    c.phone = "+92 300 1234567";
+    c.created = NO_TIME;
+    string log;
+    formatRecord(log, c, false, "");
+    CHECK(log == "NAME: Ali Khan\nPHONE: +92 300 1234567\nDATE: \n---\n");
+    log += "#SEQ 5\n";
+    ParsedChunk<Contact> p = parse<Contact>(log); // records point into log
+    CHECK(p.records.size() == 1 && p.records[0].name == c.name && p.records[0].phone == c.phone);
+    CHECK(p.records[0].created == NO_TIME && p.records[0].oddDate == 0);
+    CHECK(p.ops.size() == 1 && p.ops[0].op == 'S' && p.ops[0].seq == 5);
+}
+
+int main() {
+    testNotes();
+    testTasks();
+    testTaskText();
+    testTaskDates();
+    testContacts();
+    return testResult("format");
+}
@@ -0,0 +1,118 @@
+// Operation log writes: a flush cut short carries on where it stopped,
+// and a compaction that cannot swap its file in leaves the old log in
+// place, with every entry it lacked appended.
+#include "check.h"
+#include "stores.h"
+#include "users.h"
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+static string slurp(const string& path) {
+    ifstream in(path, ios::binary);
+    return string((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+}
+
+// what the log holds: its file, then what still waits in buf
+static string contents(StoreLog& log) {
+    logWait(log);
+    lock_guard<mutex> g(log.m);
+    if (log.file) fflush(log.file);
+    return slurp(log.path) + log.buf;
+}
+
+static void testCompaction(Durability d) {
+    durability = d;
+    string dir = scratchDir("store_log");
+    StoreLog log;
+    log.path = dir + "tasks.txt";
+    logAppend(log, "a\n");
+    logAppend(log, "b\n");
+    logHold(log);
+    logAppend(log, "c\n");
+    // the temp file cannot be created: the log keeps everything, the
+    // buffered and held entries and what came in while compacting
+    filesystem::create_directory(log.path + ".tmp");
+    logCompact(log, []() { return string("compacted\n"); });
+    logCommit(log);
+    logAppend(log, "d\n");
+    logWait(log);
+    logAppend(log, "e\n");
+    CHECK(contents(log) == "a\nb\nc\nd\ne\n");
+    CHECK(log.compactFailed);
+    // and the next compaction goes through
+    filesystem::remove(log.path + ".tmp");
+    logCompact(log, []() { return string("compacted\n"); });
+    logAppend(log, "f\n");
+    CHECK(contents(log) == "compacted\nf\n");
+    CHECK(!log.compactFailed);
+    CHECK(!filesystem::exists(log.path + ".tmp"));
+    if (log.file) fclose(log.file);
+}
+
+#ifndef _WIN32
+// a write cut short (here by the file size limit) keeps only its
+// unwritten tail; the next flush finishes the line, nothing is doubled
+static void testShortWrite() {
+    durability = Durability::PerOp;
+    StoreLog log;
+    log.path = scratchDir("store_log_short") + "notes.txt";
+    string entry(20000, 'x');
+    entry += '\n';
+    signal(SIGXFSZ, SIG_IGN);
+    rlimit old, cap;
+    getrlimit(RLIMIT_FSIZE, &old);
+    cap = old;
+    cap.rlim_cur = 8192;
+    setrlimit(RLIMIT_FSIZE, &cap);
+    logAppend(log, entry);
+    setrlimit(RLIMIT_FSIZE, &old);
+    CHECK(!log.buf.empty() && log.buf.size() < entry.size());
+    logAppend(log, "y\n");
+    CHECK(log.buf.empty());
+    CHECK(contents(log) == entry + "y\n");
+    if (log.file) fclose(log.file);
+}
+#endif
+
+// a store whose compaction failed asks for another one once
+// COMPACT_MIN more dead entries pile up, even if it would not pay off
+// by ratio; nothing is lost in between
+static void testRetry() {
+    durability = Durability::PerOp;
+    openShardDir(scratchDir("store_log_retry"));
+    loadTasks();
+    for (size_t i = 0; i < 4 * COMPACT_MIN; ++i) insertTask("t" + to_string(i));
+    for (size_t i = 0; i < COMPACT_MIN; ++i) removeTask(0);
+    CHECK(!needsCompaction(tasks));
+    filesystem::create_directory(TASKS_FILE + ".tmp");
+    rewriteTasksFile();
+    logWait(tasks.log);
+    CHECK(tasks.log.compactFailed);
+    filesystem::remove(TASKS_FILE + ".tmp");
+    for (size_t i = 0; i + 1 < COMPACT_MIN; ++i) toggleTask(i);
+    CHECK(!needsCompaction(tasks));
+    toggleTask(COMPACT_MIN - 1);
+    CHECK(needsCompaction(tasks));
+    rewriteTasksFile();
+    logWait(tasks.log);
+    CHECK(!tasks.log.compactFailed);
+    loadTasks();
+    size_t done = 0;
+    for (size_t i = 0; i < tasks.size(); ++i) done += tasks.isDone(i);
+    CHECK(tasks.size() == 3 * COMPACT_MIN && done == COMPACT_MIN);
+    CHECK(tasks[0].text == "t" + to_string(COMPACT_MIN));
+    CHECK(!needsCompaction(tasks));
+}
+
+int main() {
+    testCompaction(Durability::PerOp);
+    testCompaction(Durability::Interval);
+    testCompaction(Durability::None);
+#ifndef _WIN32
+    testShortWrite();
+#endif
+    testRetry();
+    closeLogs();
+    return testResult("store_log");
+}
@@ -0,0 +1,45 @@
+// Import: records are parsed ahead and stored IMPORT_CHUNK at a time
+// through the caller's apply, and nothing reaches a store outside it.
+#include "check.h"
+#include "stores.h"
+#include "transfer.h"
+#include "users.h"
+
+#include <sstream>
+
+static void testChunks() {
+    durability = Durability::PerOp;
+    openShardDir(scratchDir("transfer"));
+    loadTasks();
+    loadContacts();
+    size_t n = 2 * IMPORT_CHUNK + 1;
+    string jsonl;
+    for (size_t i = 0; i < n; ++i)
+        jsonl += "{\"text\": \"t" + to_string(i) + "\", \"date\": \"" + (i % 2 ? "01/02/2026 08:00" : "soon") + "\", \"priority\": 2}\n";
+    istringstream in(jsonl + "{\"text\": 5\n");
+    size_t errors = 0, applied = 0;
+    bool outside = false;
+    size_t count = importTasks(in, "tasks.jsonl", false, errors, [&](const function<void()>& store) {
+        outside = outside || tasks.size() != applied * IMPORT_CHUNK;
+        store();
+        ++applied;
+    });
+    CHECK(count == n && errors == 1 && applied == 3 && !outside);
+    CHECK(tasks.size() == n && tasks[n - 1].text == "t" + to_string(n - 1) && tasks[n - 1].priority == 2);
+    CHECK(tasks.dateOf(tasks[0]) == "soon" && tasks.dateOf(tasks[1]) == "01/02/2026 08:00");
+    // the strings live in the store, and read back from its log
+    loadTasks();
+    CHECK(tasks.size() == n && tasks[IMPORT_CHUNK].text == "t" + to_string(IMPORT_CHUNK));
+    CHECK(tasks.dateOf(tasks[IMPORT_CHUNK]) == "soon");
+
+    // without apply each chunk is stored right away
+    istringstream csv("name,phone,date\nAli,123,01/02/2026 08:00\nSara,,\n");
+    CHECK(importContacts(csv, "contacts.csv", true, errors) == 2);
+    CHECK(contacts.size() == 2 && contacts[0].name == "Ali" && contacts[0].phone == "123" && contacts[1].phone.empty());
+}
+
+int main() {
+    testChunks();
+    closeLogs();
+    return testResult("transfer");
+}
@@ -0,0 +1,166 @@
+// Undo / redo on the task store: across compaction, redo after a new
+// edit, --keep-undo reloads (and the log changing between sessions)
+// and the --undo-depth cutoff. Every check that matters is repeated
+// after reloading from the log, which must agree with memory.
+#include "check.h"
+#include "snapshot.h"
+#include "stores.h"
+#include "users.h"
+
+// live tasks in order, done ones marked with '*'
+static string listing() {
+    string out;
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        if (i) out += ' ';
+        out += tasks[i].text;
+        if (tasks.isDone(i)) out += '*';
+    }
+    return out;
+}
+
+static void addTasks(std::initializer_list<const char*> texts) {
+    for (const char* t : texts) {
+        insertTask(t);
+        recordUndo(tasks, "Add Task");
+    }
+}
+
+static string step(bool redo) {
+    string label;
+    return stepUndo(tasks, redo, label) ? label : "-";
+}
+
+static void compactNow() {
+    rewriteTasksFile();
+    logWait(tasks.log);
+}
+
+// a new empty shard; the log still open on the last one is closed first
+static void fresh(const string& name) {
+    closeLogs();
+    openShardDir(scratchDir(name));
+    loadTasks();
+}
+
+static void testAfterCompaction() {
+    fresh("undo_compact");
+    addTasks({"a", "b", "c"});
+    removeTask(1);
+    recordUndo(tasks, "Delete Task");
+    toggleTask(0);
+    recordUndo(tasks, "Toggle Task");
+    int64_t due;
+    CHECK(parseDue("03/02/2026 18:45", due) && scheduleTask(1, due, 2));
+    recordUndo(tasks, "Set Due Date");
+    CHECK(listing() == "a* c");
+    // the deleted task is kept (and deleted again) by compaction
+    compactNow();
+    CHECK(step(false) == "Set Due Date");
+    CHECK(tasks[1].due == 0 && tasks[1].priority == 0);
+    CHECK(step(false) == "Toggle Task");
+    CHECK(step(false) == "Delete Task");
+    CHECK(listing() == "a b c");
+    CHECK(tasks[1].seq == 1);
+    compactNow();
+    loadTasks();
+    CHECK(listing() == "a b c");
+    CHECK(tasks[2].due == 0);
+    CHECK(step(false) == "-");
+}
+
+static void testRedoAfterNewEdit() {
+    fresh("undo_redo");
+    addTasks({"a", "b"});
+    removeTask(1);
+    recordUndo(tasks, "Delete Task");
+    CHECK(step(false) == "Delete Task");
+    CHECK(listing() == "a b");
+    CHECK(step(true) == "Delete Task");
+    CHECK(listing() == "a");
+    CHECK(step(false) == "Delete Task");
+    // a new change drops what could be redone
+    toggleTask(1);
+    recordUndo(tasks, "Toggle Task");
+    CHECK(step(true) == "-");
+    CHECK(listing() == "a b*");
+    // an unrecorded change is closed as its own step first
+    insertTask("c");
+    CHECK(step(true) == "-");
+    CHECK(listing() == "a b* c");
+    CHECK(step(false) == "Other changes");
+    CHECK(step(false) == "Toggle Task");
+    CHECK(listing() == "a b");
+    loadTasks();
+    CHECK(listing() == "a b");
+}
+
+static void testKeepUndo() {
+    keepUndo = true;
+    fresh("undo_keep");
+    addTasks({"a", "b", "x"});
+    removeTask(2);
+    recordUndo(tasks, "Delete Task");
+    toggleTask(0);
+    recordUndo(tasks, "Toggle Task");
+    compactNow();
+    saveUndoHistories();
+    // same log: the steps carry over, including the compacted-away x
+    loadTasks();
+    CHECK(listing() == "a* b");
+    CHECK(step(false) == "Toggle Task");
+    CHECK(step(false) == "Delete Task");
+    CHECK(listing() == "a b x");
+    CHECK(step(true) == "Delete Task");
+    saveUndoHistories();
+    loadTasks();
+    CHECK(step(true) == "Toggle Task");
+    CHECK(listing() == "a* b");
+    saveUndoHistories();
+    // the log changes after the history was saved: it no longer fits
+    insertTask("c");
+    loadTasks();
+    CHECK(listing() == "a* b c");
+    CHECK(step(false) == "-");
+    CHECK(step(true) == "-");
+    keepUndo = false;
+}
+
+static void testDepth() {
+    undoDepth = 3;
+    fresh("undo_depth");
+    addTasks({"t0", "t1", "t2", "t3", "t4"});
+    int undone = 0;
+    while (step(false) != "-") ++undone;
+    CHECK(undone == 3);
+    CHECK(listing() == "t0 t1");
+    int redone = 0;
+    while (step(true) != "-") ++redone;
+    CHECK(redone == 3);
+    CHECK(listing() == "t0 t1 t2 t3 t4");
+    // a smaller depth next session keeps the newest steps
+    keepUndo = true;
+    saveUndoHistories();
+    undoDepth = 1;
+    loadTasks();
+    CHECK(step(false) == "Add Task");
+    CHECK(step(false) == "-");
+    CHECK(listing() == "t0 t1 t2 t3");
+    // depth 0 turns undo off
+    undoDepth = 0;
+    loadTasks();
+    addTasks({"t5"});
+    CHECK(step(false) == "-");
+    CHECK(listing() == "t0 t1 t2 t3 t5");
+    keepUndo = false;
+    undoDepth = 20;
+}
+
+int main() {
+    durability = Durability::PerOp; // reloads read every append
+    testAfterCompaction();
+    testRedoAfterNewEdit();
+    testKeepUndo();
+    testDepth();
+    closeLogs();
+    return testResult("undo");
+}
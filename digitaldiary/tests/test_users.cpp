@@ -0,0 +1,109 @@
+// User registry: lookups are found / missing / error, an error never
+// lets a name be registered again, and rehashing on login.
+#include "check.h"
+#include "crypto.h"
+#include "files.h"
+#include "users.h"
+
+using Lookup = UserRegistry::Lookup;
+
+static string lookup(UserRegistry& r, const string& name) {
+    string cred;
+    Lookup l = r.find(name, cred);
+    return l == Lookup::Found ? cred : l == Lookup::Missing ? "(missing)" : "(error)";
+}
+
+// point every used slot of the index at a line that is not there
+static void breakSlots(const string& indexPath) {
+    ifstream in(indexPath, ios::binary);
+    string idx((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    CHECK(idx.size() > 40);
+    for (size_t at = 40; at + 16 <= idx.size(); at += 16)
+        if (getRaw<uint64_t>(idx.data() + at + 8)) memcpy(&idx[at + 8], "\xff\xff\xff\xff\x00\x00\x00\x00", 8);
+    CHECK(writeFileAtomic(indexPath, idx));
+}
+
+static void testLookups() {
+    string dir = scratchDir("users");
+    UserRegistry r(dir + "users.txt", dir + "users.idx");
+    CHECK(lookup(r, "bob") == "(missing)");
+    CHECK(r.add("bob", "k1", true));
+    CHECK(lookup(r, "bob") == "k1");
+    // onlyNew never replaces a registered name
+    CHECK(!r.add("bob", "k2", true));
+    CHECK(lookup(r, "bob") == "k1");
+    CHECK(r.add("bob", "k2"));
+    CHECK(lookup(r, "bob") == "k2");
+    // enough names to grow the index a few times
+    for (int i = 0; i < 300; ++i) CHECK(r.add("user" + to_string(i), "c" + to_string(i), true));
+    bool all = true;
+    for (int i = 0; i < 300; ++i) all = all && lookup(r, "user" + to_string(i)) == "c" + to_string(i);
+    CHECK(all);
+    CHECK(lookup(r, "bob") == "k2");
+    CHECK(lookup(r, "alice") == "(missing)");
+    // an index rebuilt from the file agrees
+    remove((dir + "users.idx").c_str());
+    CHECK(lookup(r, "user7") == "c7");
+    CHECK(lookup(r, "bob") == "k2");
+}
+
+static void testErrors() {
+    string dir = scratchDir("users_err");
+    string text = dir + "users.txt", index = dir + "users.idx";
+    UserRegistry r(text, index);
+    CHECK(r.add("bob", "k1", true));
+    // a slot whose line cannot be read may be the name: an error, and
+    // nothing is appended for it
+    breakSlots(index);
+    int64_t size = fileSize(text);
+    CHECK(lookup(r, "bob") == "(error)");
+    CHECK(!r.add("bob", "k2", true));
+    CHECK(!r.add("bob", "k2"));
+    CHECK(fileSize(text) == size);
+    // likewise an index cut short after its header
+    remove(index.c_str());
+    CHECK(lookup(r, "bob") == "k1");
+    filesystem::resize_file(index, 40);
+    CHECK(lookup(r, "bob") == "(error)");
+    CHECK(lookup(r, "alice") == "(error)");
+    CHECK(!r.add("alice", "k3", true));
+    CHECK(fileSize(text) == size);
+}
+
+static void testVerify() {
+    keyIterations = 1000;
+    string dir = scratchDir("users_verify");
+    UserRegistry r(dir + "users.txt", dir + "users.idx");
+    // plain keys from older versions are rehashed on login
+    CHECK(r.add("bob", "k1", true));
+    CHECK(!r.verify("bob", "k1", "k2"));
+    CHECK(lookup(r, "bob") == "k1");
+    CHECK(r.verify("bob", "k1", "k1"));
+    string cred = lookup(r, "bob"), salt, hash;
+    uint32_t iterations = 0;
+    CHECK(parseCredential(cred, iterations, salt, hash) && iterations == 1000);
+    CHECK(r.verify("bob", cred, "k1"));
+    CHECK(lookup(r, "bob") == cred); // already current
+    // a rehash that cannot be stored still lets the user in
+    CHECK(r.add("carol", "k3", true));
+    filesystem::resize_file(dir + "users.idx", 40);
+    CHECK(r.verify("carol", "k3", "k3"));
+    remove((dir + "users.idx").c_str());
+    CHECK(lookup(r, "carol") == "k3");
+}
+
+static void testShardInUse() {
+    string dir = scratchDir("users_shard");
+    openShardDir(dir);
+    CHECK(!shardInUse());
+    CHECK(writeFileAtomic(TASKS_FILE, "[0] x | 01/02/2026 08:00\n"));
+    CHECK(shardInUse());
+}
+
+int main() {
+    testLookups();
+    testErrors();
+    testVerify();
+    testShardInUse();
+    return testResult("users");
+}
@@ -0,0 +1,413 @@
+#include "transfer.h"
+#include "stores.h"
+
+// ------------------- Import / Export --------------------
+// notes:    JSONL  {"date": "dd/mm/yyyy hh:mm", "content": "line\nline\n"}
+// tasks:    JSONL  {"done": false, "text": "...", "date": "..."}
+//           CSV    done,text,date   (header row, done is 0 or 1)
+// contacts: JSONL  {"name": "...", "phone": "...", "date": "..."}
+//           CSV    name,phone,date
+// A file ending in .csv is CSV, anything else JSONL. Both directions
+// stream: export formats into one buffer written out every
+// EXPORT_CHUNK bytes, import parses IMPORT_CHUNK records ahead and
+// stores them together (through ImportApply, so a daemon holds its
+// write lock only for that), adding them through the store's log while
+// it is held (see logHold). A missing "date" means now.
+
+bool isCsvPath(const string& path) {
+    return path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+}
+
+// append s as a JSON string literal
+static void jsonString(string& out, string_view s) {
+    static const char* hex = "0123456789abcdef";
+    out += '"';
+    for (char ch : s) {
+        unsigned char u = (unsigned char)ch;
+        if (ch == '"') out += "\\\"";
+        else if (ch == '\\') out += "\\\\";
+        else if (ch == '\n') out += "\\n";
+        else if (ch == '\r') out += "\\r";
+        else if (ch == '\t') out += "\\t";
+        else if (u < 0x20) { out += "\\u00"; out += hex[u >> 4]; out += hex[u & 15]; }
+        else out += ch;
+    }
+    out += '"';
+}
+
+// append s as a CSV field, quoted when it needs to be
+static void csvField(string& out, string_view s) {
+    if (s.find_first_of(",\"\r\n") == string_view::npos) { out += s; return; }
+    out += '"';
+    for (char ch : s) {
+        if (ch == '"') out += '"';
+        out += ch;
+    }
+    out += '"';
+}
+
+// Parse one flat JSON object into key/value pairs. Strings are
+// unescaped, true/false/null/numbers are kept as their text.
+static bool parseJsonObject(string_view s, vector<pair<string, string>>& fields) {
+    fields.clear();
+    size_t i = 0;
+    auto ws = [&]() { while (i < s.size() && (s[i] == ' ' || s[i] == '\t' || s[i] == '\r')) ++i; };
+    auto putUtf8 = [](string& out, uint32_t cp) {
+        if (cp < 0x80) out += (char)cp;
+        else if (cp < 0x800) { out += (char)(0xC0 | (cp >> 6)); out += (char)(0x80 | (cp & 63)); }
+        else if (cp < 0x10000) { out += (char)(0xE0 | (cp >> 12)); out += (char)(0x80 | ((cp >> 6) & 63)); out += (char)(0x80 | (cp & 63)); }
+        else { out += (char)(0xF0 | (cp >> 18)); out += (char)(0x80 | ((cp >> 12) & 63)); out += (char)(0x80 | ((cp >> 6) & 63)); out += (char)(0x80 | (cp & 63)); }
+    };
+    auto hex4 = [&](uint32_t& v) {
+        if (i + 4 > s.size()) return false;
+        v = 0;
+        for (int k = 0; k < 4; ++k) {
+            char c = s[i++];
+            v <<= 4;
+            if (c >= '0' && c <= '9') v |= c - '0';
+            else if (c >= 'a' && c <= 'f') v |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') v |= c - 'A' + 10;
+            else return false;
+        }
+        return true;
+    };
+    auto str = [&](string& out) {
+        out.clear();
+        if (i >= s.size() || s[i] != '"') return false;
+        ++i;
+        while (i < s.size() && s[i] != '"') {
+            char c = s[i++];
+            if (c != '\\') { out += c; continue; }
+            if (i >= s.size()) return false;
+            c = s[i++];
+            switch (c) {
+                case '"': case '\\': case '/': out += c; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'u': {
+                    uint32_t cp, lo;
+                    if (!hex4(cp)) return false;
+                    if (cp >= 0xD800 && cp < 0xDC00 && i + 1 < s.size() && s[i] == '\\' && s[i + 1] == 'u') {
+                        i += 2;
+                        if (!hex4(lo) || lo < 0xDC00 || lo > 0xDFFF) return false;
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                    }
+                    putUtf8(out, cp);
+                    break;
+                }
+                default: return false;
+            }
+        }
+        if (i >= s.size()) return false;
+        ++i;
+        return true;
+    };
+    ws();
+    if (i >= s.size() || s[i++] != '{') return false;
+    ws();
+    if (i < s.size() && s[i] == '}') { ++i; ws(); return i == s.size(); }
+    while (true) {
+        ws();
+        string key, value;
+        if (!str(key)) return false;
+        ws();
+        if (i >= s.size() || s[i++] != ':') return false;
+        ws();
+        if (i < s.size() && s[i] == '"') {
+            if (!str(value)) return false;
+        } else {
+            size_t b = i;
+            while (i < s.size() && s[i] != ',' && s[i] != '}' && s[i] != ' ' && s[i] != '\t') ++i;
+            value.assign(s.substr(b, i - b));
+            if (value.empty() || value[0] == '{' || value[0] == '[') return false;
+        }
+        fields.emplace_back(move(key), move(value));
+        ws();
+        if (i >= s.size()) return false;
+        if (s[i] == ',') { ++i; continue; }
+        if (s[i++] != '}') return false;
+        ws();
+        return i == s.size();
+    }
+}
+
+// value of key in parsed JSON fields, nullptr if absent
+static const string* jsonField(const vector<pair<string, string>>& fields, const char* key) {
+    for (const auto& f : fields) if (f.first == key) return &f.second;
+    return nullptr;
+}
+
+// Read one CSV record (quoted fields may span lines); false at end of input
+static bool readCsvRecord(istream& in, vector<string>& fields, size_t& lineNo) {
+    fields.clear();
+    string line;
+    if (!getline(in, line)) return false;
+    ++lineNo;
+    string field;
+    bool quoted = false;
+    size_t i = 0;
+    while (true) {
+        if (i >= line.size()) {
+            if (quoted) {
+                // a quoted field continues on the next line
+                if (!getline(in, line)) break;
+                ++lineNo;
+                field += '\n';
+                i = 0;
+                continue;
+            }
+            break;
+        }
+        char c = line[i++];
+        if (quoted) {
+            if (c == '"') {
+                if (i < line.size() && line[i] == '"') { field += '"'; ++i; }
+                else quoted = false;
+            } else {
+                field += c;
+            }
+        } else if (c == '"' && field.empty()) {
+            quoted = true;
+        } else if (c == ',') {
+            fields.push_back(move(field));
+            field.clear();
+        } else if (!(c == '\r' && i == line.size())) {
+            field += c;
+        }
+    }
+    fields.push_back(move(field));
+    return true;
+}
+
+// true if s fits on one log line
+static bool singleLine(string_view s) { return s.find_first_of("\r\n") == string_view::npos; }
+
+// store hook for imported records
+static void storeImported(const Note& n, bool) { storeNote(n); }
+static void storeImported(const Task& t, bool done) { storeTask(t, done); }
+static void storeImported(const Contact& c, bool) { storeContact(c); }
+
+// Parsed import records not yet stored. Their strings (and dates that
+// do not parse) are held here until the store keeps its own copies.
+template <typename T>
+struct ImportChunk {
+    vector<T> records;
+    vector<bool> done;
+    vector<string_view> oddDates; // per record, for created == NO_TIME
+    deque<string> text;
+
+    string_view hold(string_view s) { return text.emplace_back(s); }
+    // a new record dated date (or now)
+    T& add(const string* date, int64_t now, bool isDone) {
+        T& r = records.emplace_back();
+        r.created = now;
+        if (date && !parseDateTime(*date, r.created)) r.created = NO_TIME;
+        r.oddDate = 0;
+        oddDates.push_back(r.created == NO_TIME ? hold(*date) : string_view());
+        done.push_back(isDone);
+        return r;
+    }
+    // store the records in s, through apply when given
+    void flush(RecordStore<T>& s, const ImportApply& apply) {
+        if (records.empty()) return;
+        auto store = [&]() {
+            for (size_t i = 0; i < records.size(); ++i) {
+                T& r = records[i];
+                forEachField<T>([&](const auto& field) {
+                    constexpr FieldKind K = kindOf<decltype(field)>;
+                    if constexpr (K == FieldKind::Text || K == FieldKind::Body) r.*field.member = s.keep(r.*field.member);
+                });
+                setDate(r, s.oddDates, r.created == NO_TIME ? s.keep(oddDates[i]) : string_view(), r.created);
+                storeImported(r, done[i]);
+            }
+        };
+        if (apply) apply(store);
+        else store();
+        records.clear(); done.clear(); oddDates.clear(); text.clear();
+    }
+};
+
+// JSONL keys and CSV columns follow the schema; CSV has the one-line
+// fields, done as 1 / 0, and no optional ones
+template <typename T>
+void exportRecords(ExportWriter& w, const RecordStore<T>& s, bool csv) {
+    if (csv) {
+        string& out = w.buffer();
+        const char* sep = "";
+        forEachField<T>([&](const auto& field) {
+            constexpr FieldKind K = kindOf<decltype(field)>;
+            if constexpr (K == FieldKind::Done || K == FieldKind::Text || K == FieldKind::Date) {
+                out += sep;
+                out += field.name;
+                sep = ",";
+            }
+        });
+        out += '\n';
+    }
+    for (size_t i = 0; i < s.size(); ++i) {
+        string& out = w.buffer();
+        const T& r = s[i];
+        const char* sep = csv ? "" : "{";
+        forEachField<T>([&](const auto& field) {
+            constexpr FieldKind K = kindOf<decltype(field)>;
+            if (csv) {
+                if constexpr (K == FieldKind::Done || K == FieldKind::Text || K == FieldKind::Date) {
+                    out += sep;
+                    sep = ",";
+                    if constexpr (K == FieldKind::Done) out += s.isDone(i) ? '1' : '0';
+                    else if constexpr (K == FieldKind::Date) csvField(out, s.dateOf(r));
+                    else csvField(out, fieldText(r, field.member));
+                }
+                return;
+            }
+            if constexpr (K == FieldKind::Due || K == FieldKind::Priority)
+                if (!(r.*field.member)) return;
+            out += sep;
+            sep = ", ";
+            out += '"';
+            out += field.name;
+            out += "\": ";
+            if constexpr (K == FieldKind::Done) out += s.isDone(i) ? "true" : "false";
+            else if constexpr (K == FieldKind::Date) jsonString(out, s.dateOf(r));
+            else if constexpr (K == FieldKind::Due) jsonString(out, dueDates.format(int64_t(r.*field.member) * 60));
+            else if constexpr (K == FieldKind::Priority) out += char('0' + r.*field.member);
+            else jsonString(out, fieldText(r, field.member));
+        });
+        out += csv ? "\n" : "}\n";
+        w.done();
+    }
+}
+
+// Import notes from JSONL. Records that would not survive a round trip
+// through notes.txt (a content line of just "~", a multi-line date)
+// are skipped and reported. Returns the number imported.
+size_t importNotes(istream& in, const string& name, size_t& errors, const ImportApply& apply) {
+    string line, content;
+    int64_t now = currentMinute();
+    ImportChunk<Note> chunk;
+    vector<pair<string, string>> fields;
+    size_t lineNo = 0, count = 0;
+    while (getline(in, line)) {
+        ++lineNo;
+        if (line.find_first_not_of(" \t\r") == string::npos) continue;
+        const string *date = nullptr, *text = nullptr;
+        bool ok = parseJsonObject(line, fields);
+        if (ok) {
+            date = jsonField(fields, "date");
+            text = jsonField(fields, "content");
+            ok = text && (!date || singleLine(*date));
+        }
+        if (ok) {
+            // same shape as typed notes: lines without CR, each ending in '\n'
+            content.clear();
+            for (char ch : *text) if (ch != '\r') content += ch;
+            if (!content.empty() && content.back() != '\n') content += '\n';
+            ok = content.find("\n~\n") == string::npos && content.compare(0, 2, "~\n") != 0;
+        }
+        if (!ok) {
+            cerr << name << ":" << lineNo << ": skipped bad note\n";
+            ++errors;
+            continue;
+        }
+        chunk.add(date, now, false).content = chunk.hold(content);
+        if (++count % IMPORT_CHUNK == 0) chunk.flush(notes, apply);
+    }
+    chunk.flush(notes, apply);
+    return count;
+}
+
+size_t importTasks(istream& in, const string& name, bool csv, size_t& errors, const ImportApply& apply) {
+    string line;
+    int64_t now = currentMinute();
+    ImportChunk<Task> chunk;
+    vector<pair<string, string>> fields;
+    vector<string> cols;
+    size_t lineNo = 0, count = 0;
+    bool header = csv;
+    while (true) {
+        size_t at = lineNo + 1;
+        const string *done = nullptr, *text = nullptr, *date = nullptr, *due = nullptr, *priority = nullptr;
+        bool ok;
+        if (csv) {
+            if (!readCsvRecord(in, cols, lineNo)) break;
+            if (header) { header = false; if (!cols.empty() && cols[0] == "done") continue; }
+            if (cols.size() == 1 && cols[0].empty()) continue;
+            ok = cols.size() >= 2 && cols.size() <= 3;
+            if (ok) { done = &cols[0]; text = &cols[1]; if (cols.size() == 3) date = &cols[2]; }
+        } else {
+            if (!getline(in, line)) break;
+            ++lineNo;
+            if (line.find_first_not_of(" \t\r") == string::npos) continue;
+            ok = parseJsonObject(line, fields);
+            if (ok) {
+                done = jsonField(fields, "done"); text = jsonField(fields, "text"); date = jsonField(fields, "date");
+                due = jsonField(fields, "due"); priority = jsonField(fields, "priority");
+            }
+        }
+        int64_t dueAt = NO_TIME;
+        uint32_t dueAtMinutes = 0;
+        ok = ok && text && singleLine(*text) && (!date || taskDateOk(*date))
+            && (!due || (parseDue(*due, dueAt) && dueMinutes(dueAt, dueAtMinutes)))
+            && (!priority || (priority->size() == 1 && (*priority)[0] >= '0' && (*priority)[0] <= '3'));
+        if (!ok) {
+            cerr << name << ":" << at << ": skipped bad task\n";
+            ++errors;
+            continue;
+        }
+        Task& t = chunk.add(date, now, done && (*done == "1" || *done == "true"));
+        t.text = chunk.hold(*text);
+        t.due = dueAtMinutes;
+        if (priority) t.priority = uint8_t((*priority)[0] - '0');
+        if (++count % IMPORT_CHUNK == 0) chunk.flush(tasks, apply);
+    }
+    chunk.flush(tasks, apply);
+    return count;
+}
+
+size_t importContacts(istream& in, const string& name, bool csv, size_t& errors, const ImportApply& apply) {
+    string line;
+    int64_t now = currentMinute();
+    ImportChunk<Contact> chunk;
+    vector<pair<string, string>> fields;
+    vector<string> cols;
+    size_t lineNo = 0, count = 0;
+    bool header = csv;
+    while (true) {
+        size_t at = lineNo + 1;
+        const string *cname = nullptr, *phone = nullptr, *date = nullptr;
+        bool ok;
+        if (csv) {
+            if (!readCsvRecord(in, cols, lineNo)) break;
+            if (header) { header = false; if (!cols.empty() && cols[0] == "name") continue; }
+            if (cols.size() == 1 && cols[0].empty()) continue;
+            ok = cols.size() >= 1 && cols.size() <= 3;
+            if (ok) { cname = &cols[0]; if (cols.size() > 1) phone = &cols[1]; if (cols.size() == 3) date = &cols[2]; }
+        } else {
+            if (!getline(in, line)) break;
+            ++lineNo;
+            if (line.find_first_not_of(" \t\r") == string::npos) continue;
+            ok = parseJsonObject(line, fields);
+            if (ok) { cname = jsonField(fields, "name"); phone = jsonField(fields, "phone"); date = jsonField(fields, "date"); }
+        }
+        ok = ok && cname && !cname->empty() && singleLine(*cname)
+            && (!phone || singleLine(*phone)) && (!date || singleLine(*date));
+        if (!ok) {
+            cerr << name << ":" << at << ": skipped bad contact\n";
+            ++errors;
+            continue;
+        }
+        Contact& c = chunk.add(date, now, false);
+        c.name = chunk.hold(*cname);
+        if (phone) c.phone = chunk.hold(*phone);
+        if (++count % IMPORT_CHUNK == 0) chunk.flush(contacts, apply);
+    }
+    chunk.flush(contacts, apply);
+    return count;
+}
+
+template void exportRecords(ExportWriter&, const RecordStore<Note>&, bool);
+template void exportRecords(ExportWriter&, const RecordStore<Task>&, bool);
+template void exportRecords(ExportWriter&, const RecordStore<Contact>&, bool);
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "record_store.h"
+
+// ------------------- Import / Export --------------------
+// Output sink for exports: "-" is stdout
+class ExportWriter {
+public:
+    bool open(const string& path) {
+        f = (path == "-") ? stdout : fopen(path.c_str(), "wb");
+        if (f && f != stdout) STAT_IO(fileOpens, 1);
+        return f != nullptr;
+    }
+    // buffer to format into; call done() after each record
+    string& buffer() { return buf; }
+    void done() { if (buf.size() >= EXPORT_CHUNK) flush(); }
+    bool close() {
+        flush();
+        if (!f) return false;
+        bool closeOk = (f == stdout) ? fflush(f) == 0 : fclose(f) == 0;
+        f = nullptr;
+        return ok && closeOk;
+    }
+    ~ExportWriter() { if (f && f != stdout) fclose(f); }
+private:
+    FILE* f = nullptr;
+    string buf;
+    bool ok = true;
+    void flush() {
+        if (f && !buf.empty()) {
+            ok = fwrite(buf.data(), 1, buf.size(), f) == buf.size() && ok;
+            if (f != stdout) STAT_IO(bytesWritten, buf.size());
+        }
+        buf.clear();
+    }
+};
+
+// A file ending in .csv is CSV, anything else JSONL
+bool isCsvPath(const string& path);
+// Write a store as JSONL (or CSV for tasks / contacts)
+template <typename T> void exportRecords(ExportWriter& w, const RecordStore<T>& s, bool csv);
+// Stores a chunk of parsed import records: apply(store) runs store
+// under whatever guards the stores (the daemon queues it as a write).
+// Empty: each chunk is stored right away.
+using ImportApply = function<void(const function<void()>&)>;
+// Add records read from a stream; bad ones are reported and counted in
+// errors. The stream is read and parsed outside apply.
+size_t importNotes(istream& in, const string& name, size_t& errors, const ImportApply& apply = {});
+size_t importTasks(istream& in, const string& name, bool csv, size_t& errors, const ImportApply& apply = {});
+size_t importContacts(istream& in, const string& name, bool csv, size_t& errors, const ImportApply& apply = {});
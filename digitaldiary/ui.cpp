@@ -0,0 +1,476 @@
+#include "ui.h"
+#include "stores.h"
+#include "terminal.h"
+
+// ---------- UI Helpers -----------
+//title function
+void showTitle() {
+    cout << "\n" << INDENT << BG_BLUE_WHITE << BOLD << "=== MINI DIGITAL DIARY ===" << RESET << "\n";
+}
+
+// Ask for two dd/mm/yyyy dates and page through the records of s
+// created between them (both days included). The range is looked up
+// in s.byTime; only the rows on screen are mapped back to positions.
+template <typename T>
+void viewBetween(RecordStore<T>& s, StatOp stat, const string& what, const function<void(string&)>& header,
+                 const function<void(string&, size_t)>& row) {
+    if (s.empty()) { cout << INDENT << YELLOW << "No " << what << "." << RESET << "\n"; return; }
+    string a, b;
+    cout << INDENT << YELLOW << "From date (dd/mm/yyyy): " << RESET; cin >> a;
+    cout << INDENT << YELLOW << "To date (dd/mm/yyyy): " << RESET; cin >> b;
+    int64_t from, fromEnd, toStart, to;
+    if (!parseDay(a, from, fromEnd) || !parseDay(b, toStart, to)) {
+        cout << INDENT << RED << "Invalid date." << RESET << "\n";
+        return;
+    }
+    if (to < from) { swap(a, b); from = toStart; to = fromEnd; }
+    vector<size_t> hits;
+    s.range(from, to, hits);
+    if (hits.empty()) { cout << INDENT << YELLOW << "No " << what << " between " << a << " and " << b << "." << RESET << "\n"; return; }
+    cout << INDENT << WHITE << BOLD << "---- " << hits.size() << " " << what << " from " << a << " to " << b << " ----" << RESET << "\n";
+    pagedView(stat, hits.size(), header, [&](string& out, size_t i) {
+        size_t at = s.indexOfSeq(hits[i]);
+        if (at != SIZE_MAX) row(out, at);
+    });
+}
+
+// " (what it takes back)" for the Undo (or Redo) menu item of s
+template <typename T>
+string undoLabel(const RecordStore<T>& s, bool redo) {
+    const deque<StoreHistory::Step>& d = redo ? s.history.redo : s.history.undo;
+    return d.empty() ? string() : " (" + d.back().label + ")";
+}
+
+// Undo (or redo) the last change to s made from its menu
+template <typename T>
+void undoLast(RecordStore<T>& s, bool redo, void (*rewrite)()) {
+    string label;
+    if (!stepUndo(s, redo, label)) {
+        cout << INDENT << YELLOW << (redo ? "Nothing to redo." : "Nothing to undo.") << RESET << "\n";
+        return;
+    }
+    if (needsCompaction(s)) rewrite();
+    cout << INDENT << CYAN << (redo ? "Redid: " : "Undid: ") << label << RESET << "\n";
+}
+
+//--------- Notes UI ----------
+//adding notes
+void addNote() {
+    safeIgnoreNewline();
+    string content;
+    cout << INDENT << WHITE << BOLD <<
+	 "Enter note (multi-line). End with a single line containing only ~" << RESET << "\n";
+    string line;
+    while (true) {
+        getline(cin, line);
+        if (trimCR(line) == "~") break;
+        content += line + "\n";
+    }
+    const Note& n = insertNote(content);
+    recordUndo(notes, "Add Note");
+    cout << INDENT << CYAN << "Note saved at " << notes.dateOf(n) << RESET << "\n";
+}
+//view notes function
+void viewNotes() {
+    if (notes.empty()) { cout << INDENT << YELLOW << "No notes." << RESET << "\n"; return; }
+    pagedView(STAT_VIEW_NOTES, notes.size(), [](string& out) {
+        out += INDENT + WHITE BOLD "---- Notes (" + to_string(notes.size()) + ") ----" RESET "\n";
+    }, formatNoteBlock);
+}
+//format one note block, numbered by position
+void formatNoteBlock(string& out, size_t i) {
+    out += INDENT + BG_BLUE_WHITE " Note #" + to_string(i+1) + "  Date: ";
+    out += notes.dateOf(notes[i]);
+    out += RESET "\n";
+    out += INDENT + "----------------------\n";
+    string_view c = noteText(notes[i]);
+    size_t pos = 0;
+    while (pos < c.size()) {
+        size_t next = c.find('\n', pos);
+        string_view ln = (next == string_view::npos ? c.substr(pos) : c.substr(pos, next - pos));
+        out += INDENT;
+        out += "  ";
+        out += ln;
+        out += '\n';
+        if (next == string_view::npos) break;
+        pos = next + 1;
+    }
+    out += INDENT + "----------------------\n\n";
+}
+//search notes function: words are ANDed, "quoted text" is a phrase
+void searchNotes() {
+    if (notes.empty()) { cout << INDENT << YELLOW << "No notes." << RESET << "\n"; return; }
+    safeIgnoreNewline();
+    cout << INDENT << YELLOW << "Search for (words, \"exact phrase\"): " << RESET;
+    string query;
+    getline(cin, query);
+    auto t0 = chrono::steady_clock::now();
+    vector<size_t> hits = noteIndex.search(query, SEARCH_LIMIT);
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+    if (hits.empty()) { cout << INDENT << YELLOW << "No matching notes." << RESET << "\n"; return; }
+    cout << INDENT << WHITE << BOLD << "---- " << hits.size() << " newest matches (" << fixed << setprecision(2) << ms << " ms) ----" << RESET << "\n";
+    cout.unsetf(ios::fixed);
+    string out;
+    for (size_t seq : hits) {
+        size_t at = notes.indexOfSeq(seq);
+        if (at != SIZE_MAX) formatNoteBlock(out, at);
+    }
+    writeOut(out);
+}
+//notes added between two dates
+void notesBetween() {
+    viewBetween(notes, STAT_VIEW_NOTES, "notes", [](string&) {}, formatNoteBlock);
+}
+//delete single note function
+void deleteSingleNote() {
+    if (notes.empty()) { cout << INDENT << YELLOW << "No notes to delete." << RESET << "\n"; return; }
+    viewNotes();
+    cout << INDENT << YELLOW << "Enter note number to delete (0 cancel): " << RESET;
+    long long k; cin >> k;
+    if (k <= 0 || k > (long long)notes.size()) { cout << INDENT << YELLOW << "Cancelled." << RESET << "\n"; return; }
+    removeNote(k - 1);
+    recordUndo(notes, "Delete Note");
+    if (needsCompaction(notes)) rewriteNotesFile();
+    cout << INDENT << CYAN << "Deleted note #" << k << RESET << "\n";
+}
+
+//delete the notes created before a date, in one pass
+void deleteOldNotes() {
+    if (notes.empty()) { cout << INDENT << YELLOW << "No notes to delete." << RESET << "\n"; return; }
+    cout << INDENT << YELLOW << "Delete notes older than (dd/mm/yyyy): " << RESET;
+    string d; cin >> d;
+    int64_t first, last;
+    if (!parseDay(d, first, last)) { cout << INDENT << RED << "Invalid date." << RESET << "\n"; return; }
+    cout << INDENT << RED << "Are you sure you want to DELETE all notes from before " << d << "? (y/N): " << RESET;
+    char ch; cin >> ch;
+    if (ch != 'y' && ch != 'Y') { cout << INDENT << YELLOW << "Cancelled." << RESET << "\n"; return; }
+    size_t n = removeNotesBefore(first);
+    recordUndo(notes, "Delete Notes Older Than " + d);
+    if (needsCompaction(notes)) rewriteNotesFile();
+    cout << INDENT << CYAN << "Deleted " << n << " notes." << RESET << "\n";
+}
+
+//delete all notes functions
+void deleteAllNotes() {
+    if (notes.empty()) { cout << INDENT << YELLOW << "No notes to delete." << RESET << "\n"; return; }
+    cout << INDENT << RED << "Are you sure you want to DELETE ALL notes? (y/N): " << RESET;
+    char ch; cin >> ch;
+    if (ch == 'y' || ch == 'Y') {
+        removeAllNotes();
+        recordUndo(notes, "Delete All Notes");
+        cout << INDENT << CYAN << "All notes deleted." << RESET << "\n";
+    } else {
+        cout << INDENT << YELLOW << "Cancelled." << RESET << "\n";
+    }
+}
+
+// ---------- Tasks UI -----------
+//add task function
+void addTask() {
+    safeIgnoreNewline();
+    cout << INDENT << YELLOW << "Enter task description: " << RESET;
+    string text;
+    getline(cin, text);
+    const Task& t = insertTask(text);
+    recordUndo(tasks, "Add Task");
+    cout << INDENT << CYAN << "Task added at " << tasks.dateOf(t) << RESET << "\n";
+}
+//view task function
+void viewTasks() {
+    if (tasks.empty()) { cout << INDENT << YELLOW << "No tasks." << RESET << "\n"; return; }
+    pagedView(STAT_VIEW_TASKS, tasks.size(), [](string& out) {
+        out += INDENT + YELLOW "---- Tasks (" + to_string(tasks.doneCount()) + " of "
+            + to_string(tasks.size()) + " done) ----" RESET "\n";
+    }, formatTaskRow);
+}
+//format one task row, numbered by position
+void formatTaskRow(string& out, size_t i) {
+    out += INDENT;
+    padLeft(out, to_string(i+1), 3);
+    out += ". [";
+    out += (tasks.isDone(i) ? 'x' : ' ');
+    out += "] ";
+    out += tasks[i].text;
+    out += " (Added: ";
+    string_view date = tasks.dateOf(tasks[i]);
+    out += (date.empty() ? "unknown" : date);
+    out += ")";
+    const Task& t = tasks[i];
+    if (t.due) {
+        bool late = !tasks.isDone(i) && taskDue(t) < (int64_t)time(0);
+        out += late ? RED "  overdue since " : "  due ";
+        out += formatDateTime(taskDue(t));
+        if (late) out += RESET;
+    }
+    if (t.priority) {
+        static const char* const names[] = {"", "high", "normal", "low"};
+        out += "  [";
+        out += names[t.priority];
+        out += ']';
+    }
+    out += "\n";
+}
+//toggle or delete function
+void toggleOrDeleteTask() {
+    if (tasks.empty()) { cout << INDENT << YELLOW << "No tasks." << RESET << "\n"; return; }
+    viewTasks();
+    cout << INDENT << YELLOW << "Enter task number (0 cancel): " << RESET;
+    long long k; cin >> k;
+    if (k <= 0 || k > (long long)tasks.size()) { cout << INDENT << YELLOW << "Cancelled." << RESET << "\n"; return; }
+    cout << INDENT << YELLOW << " 1.Toggle \n" << INDENT << " 2.Delete \n" << INDENT << " Enter choice:  " << RESET;
+    int c; cin >> c;
+    if (c == 1) {
+        toggleTask(k - 1);
+        recordUndo(tasks, "Toggle Task");
+        if (needsCompaction(tasks)) rewriteTasksFile();
+        cout << INDENT << CYAN << "Toggled." << RESET << "\n";
+    } else if (c == 2) {
+        removeTask(k - 1);
+        recordUndo(tasks, "Delete Task");
+        if (needsCompaction(tasks)) rewriteTasksFile();
+        cout << INDENT << CYAN << "Deleted." << RESET << "\n";
+    } else {
+        cout << INDENT << RED << "Invalid option." << RESET << "\n";
+    }
+}
+
+//tasks added between two dates
+void tasksBetween() {
+    viewBetween(tasks, STAT_VIEW_TASKS, "tasks", [](string&) {}, formatTaskRow);
+}
+
+//delete every completed task, in one pass
+void deleteCompletedTasks() {
+    if (tasks.doneCount() == 0) { cout << INDENT << YELLOW << "No completed tasks." << RESET << "\n"; return; }
+    size_t n = removeDoneTasks();
+    recordUndo(tasks, "Delete Completed Tasks");
+    if (needsCompaction(tasks)) rewriteTasksFile();
+    cout << INDENT << CYAN << "Deleted " << n << " completed tasks." << RESET << "\n";
+}
+
+//set or clear the due date and priority of one task
+void setTaskSchedule() {
+    if (tasks.empty()) { cout << INDENT << YELLOW << "No tasks." << RESET << "\n"; return; }
+    viewTasks();
+    cout << INDENT << YELLOW << "Enter task number (0 cancel): " << RESET;
+    long long k; cin >> k;
+    if (k <= 0 || k > (long long)tasks.size()) { cout << INDENT << YELLOW << "Cancelled." << RESET << "\n"; return; }
+    const Task& t = tasks[k - 1];
+    safeIgnoreNewline();
+    string d, p;
+    cout << INDENT << YELLOW << "Due date (dd/mm/yyyy [hh:mm], - for none, Enter to keep): " << RESET;
+    getline(cin, d);
+    int64_t due = taskDue(t);
+    if (!trimCR(d).empty() && !parseDue(trimCR(d), due)) { cout << INDENT << RED << "Invalid date." << RESET << "\n"; return; }
+    cout << INDENT << YELLOW << "Priority (1 high, 2 normal, 3 low, 0 none, Enter to keep): " << RESET;
+    getline(cin, p);
+    p = trimCR(p);
+    uint8_t priority = t.priority;
+    if (p.size() == 1 && p[0] >= '0' && p[0] <= '3') priority = uint8_t(p[0] - '0');
+    else if (!p.empty()) { cout << INDENT << RED << "Invalid priority." << RESET << "\n"; return; }
+    scheduleTask(k - 1, due, priority);
+    recordUndo(tasks, "Set Due Date / Priority");
+    if (needsCompaction(tasks)) rewriteTasksFile();
+    cout << INDENT << CYAN << "Task #" << k << " updated." << RESET << "\n";
+}
+
+//open tasks by due date, soonest (and overdue) first; only the pages
+//looked at are taken off the schedule
+void nextUpTasks() {
+    size_t count = taskSchedule.size();
+    if (!count) { cout << INDENT << YELLOW << "No open tasks with a due date." << RESET << "\n"; return; }
+    vector<uint32_t> order;
+    pagedView(STAT_VIEW_TASKS, count, [&](string& out) {
+        out += INDENT + YELLOW "---- Next Up (" + to_string(count) + " due) ----" RESET "\n";
+    }, [&](string& out, size_t i) {
+        if (i >= order.size()) taskSchedule.next(max(i + 1, 2 * order.size()), NO_TIME, order);
+        formatTaskRow(out, tasks.indexOfSeq(order[i]));
+    });
+}
+
+//overdue tasks, read off the front of the schedule
+void showReminders() {
+    const size_t shown = 5;
+    waitTasks();
+    vector<uint32_t> late;
+    taskSchedule.next(shown + 1, (int64_t)time(0), late);
+    if (late.empty()) return;
+    string out = "\n" + INDENT + RED BOLD "Overdue tasks:" RESET "\n";
+    for (size_t k = 0; k < late.size() && k < shown; ++k) formatTaskRow(out, tasks.indexOfSeq(late[k]));
+    if (late.size() > shown) out += INDENT + "... and more under Tasks > Next Up\n";
+    writeOut(out);
+}
+
+// -------------------- Contacts UI -----------------------
+//add contact function
+void addContact() {
+    safeIgnoreNewline();
+    string name, phone;
+    cout << INDENT << CYAN << "Enter name: " << RESET; getline(cin, name);
+    cout << INDENT << CYAN << "Enter phone: " << RESET; getline(cin, phone);
+    const Contact& c = insertContact(name, phone);
+    recordUndo(contacts, "Add Contact");
+    cout << INDENT << CYAN << "Contact saved at " << contacts.dateOf(c) << RESET << "\n";
+}
+//view contacts function
+void viewContacts() {
+    if (contacts.empty()) { cout << INDENT << YELLOW << "No contacts." << RESET << "\n"; return; }
+    pagedView(STAT_VIEW_CONTACTS, contacts.size(), [](string& out) {
+        out += INDENT + CYAN "---- Contacts (" + to_string(contacts.size()) + ") ----" RESET "\n";
+        formatContactHeader(out);
+    }, formatContactRow);
+}
+//table header for contact listings
+void formatContactHeader(string& out) {
+    out += INDENT;
+    padRight(out, "No", 5);
+    padRight(out, "Name", 30);
+    padRight(out, "Phone", 18);
+    padRight(out, "Added", 20);
+    out += RESET "\n";
+    out += INDENT + string(73, '-') + "\n";
+}
+//format one contact row, numbered by position
+void formatContactRow(string& out, size_t i) {
+    out += INDENT;
+    padRight(out, to_string(i+1), 5);
+    padRight(out, (contacts[i].name.size() > 28 ? contacts[i].name.substr(0,28) : contacts[i].name), 30);
+    padRight(out, contacts[i].phone, 18);
+    string_view date = contacts.dateOf(contacts[i]);
+    padRight(out, (date.empty() ? "unknown" : date), 20);
+    out += '\n';
+}
+//find contacts by name prefix (any case) or, for digit-only input, phone prefix
+void findContact() {
+    if (contacts.empty()) { cout << INDENT << YELLOW << "No contacts." << RESET << "\n"; return; }
+    safeIgnoreNewline();
+    cout << INDENT << CYAN << "Name or phone starts with: " << RESET;
+    string q;
+    getline(cin, q);
+    q = trimCR(q);
+    bool byName = false;
+    for (char ch : q) if (isalpha((unsigned char)ch)) byName = true;
+    string key = byName ? nameKey(q) : phoneKey(q);
+    if (key.empty()) { cout << INDENT << YELLOW << "Cancelled." << RESET << "\n"; return; }
+    vector<uint32_t> hits;
+    (byName ? contactIndex.byName : contactIndex.byPhone).find(key, SEARCH_LIMIT, hits);
+    if (hits.empty()) { cout << INDENT << YELLOW << "No matching contacts." << RESET << "\n"; return; }
+    cout << INDENT << CYAN << "---- Matches (" << hits.size() << (hits.size() == SEARCH_LIMIT ? "+" : "") << ") ----" << RESET << "\n";
+    string out;
+    formatContactHeader(out);
+    for (uint32_t seq : hits) {
+        size_t at = contacts.indexOfSeq(seq);
+        if (at != SIZE_MAX) formatContactRow(out, at);
+    }
+    writeOut(out);
+}
+//contacts added between two dates
+void contactsBetween() {
+    viewBetween(contacts, STAT_VIEW_CONTACTS, "contacts", formatContactHeader, formatContactRow);
+}
+//delete single contact function
+void deleteSingleContact() {
+    if (contacts.empty()) { cout << INDENT << YELLOW << "No contacts to delete." << RESET << "\n"; return; }
+    viewContacts();
+    cout << INDENT << YELLOW << "Enter contact number to delete (0 cancel): " << RESET;
+    long long k; cin >> k;
+    if (k <= 0 || k > (long long)contacts.size()) { cout << INDENT << YELLOW << "Cancelled." << RESET << "\n"; return; }
+    removeContact(k - 1);
+    recordUndo(contacts, "Delete Contact");
+    if (needsCompaction(contacts)) rewriteContactsFile();
+    cout << INDENT << CYAN << "Deleted contact #" << k << RESET << "\n";
+}
+//delete all contact function
+void deleteAllContacts() {
+    if (contacts.empty()) { cout << INDENT << YELLOW << "No contacts to delete." << RESET << "\n"; return; }
+    cout << INDENT << RED << "Are you sure you want to DELETE ALL contacts? (y/N): " << RESET;
+    char ch; cin >> ch;
+    if (ch == 'y' || ch == 'Y') {
+        removeAllContacts();
+        recordUndo(contacts, "Delete All Contacts");
+        cout << INDENT << CYAN << "All contacts deleted." << RESET << "\n";
+    } else {
+        cout << INDENT << YELLOW << "Cancelled." << RESET << "\n";
+    }
+}
+
+// ---------------------- Menus ---------------------------
+
+void notesMenu() {
+    waitNotes();
+    while (true) {
+        cout << "\n" << INDENT << WHITE << " -- NOTES -- " << RESET << "\n";
+        cout << INDENT << "1. Add Note\n" << INDENT << "2. View Notes\n"
+             << INDENT << "3. Delete Single Note\n" << INDENT << "4. Delete All Notes\n"
+             << INDENT << "5. Search Notes\n" << INDENT << "6. Notes Between Dates\n"
+             << INDENT << "7. Delete Notes Older Than a Date\n"
+             << INDENT << "8. Undo" << undoLabel(notes, false) << "\n"
+             << INDENT << "9. Redo" << undoLabel(notes, true) << "\n"
+             << INDENT << "0. Back\n";
+        cout << INDENT << "Choose: ";
+        int ch; cin >> ch;
+        if (ch == 1) addNote();
+        else if (ch == 2) viewNotes();
+        else if (ch == 3) deleteSingleNote();
+        else if (ch == 4) deleteAllNotes();
+        else if (ch == 5) searchNotes();
+        else if (ch == 6) notesBetween();
+        else if (ch == 7) deleteOldNotes();
+        else if (ch == 8) undoLast(notes, false, rewriteNotesFile);
+        else if (ch == 9) undoLast(notes, true, rewriteNotesFile);
+        else if (ch == 0) break;
+        else cout << INDENT << RED << "Invalid." << RESET << "\n";
+    }
+}
+
+void tasksMenu() {
+    waitTasks();
+    while (true) {
+        cout << "\n" << INDENT << YELLOW << " -- TASKS -- " << RESET << "\n";
+        cout << INDENT << "1. Add Task\n" << INDENT << "2. View Tasks\n"
+             << INDENT << "3. Toggle/Delete Task\n" << INDENT << "4. Tasks Between Dates\n"
+             << INDENT << "5. Delete Completed Tasks\n" << INDENT << "6. Set Due Date / Priority\n"
+             << INDENT << "7. Next Up\n"
+             << INDENT << "8. Undo" << undoLabel(tasks, false) << "\n"
+             << INDENT << "9. Redo" << undoLabel(tasks, true) << "\n"
+             << INDENT << "0. Back\n";
+        cout << INDENT << "Choose: ";
+        int ch; cin >> ch;
+        if (ch == 1) addTask();
+        else if (ch == 2) viewTasks();
+        else if (ch == 3) toggleOrDeleteTask();
+        else if (ch == 4) tasksBetween();
+        else if (ch == 5) deleteCompletedTasks();
+        else if (ch == 6) setTaskSchedule();
+        else if (ch == 7) nextUpTasks();
+        else if (ch == 8) undoLast(tasks, false, rewriteTasksFile);
+        else if (ch == 9) undoLast(tasks, true, rewriteTasksFile);
+        else if (ch == 0) break;
+        else cout << INDENT << RED << "Invalid." << RESET << "\n";
+    }
+}
+
+void contactsMenu() {
+    waitContacts();
+    while (true) {
+        cout << "\n" << INDENT << CYAN << " -- CONTACTS -- " << RESET << "\n";
+        cout << INDENT << "1. Add Contact\n" << INDENT << "2. View Contacts\n"
+             << INDENT << "3. Delete Single Contact\n" << INDENT << "4. Delete All Contacts\n"
+             << INDENT << "5. Find Contact\n" << INDENT << "6. Contacts Between Dates\n"
+             << INDENT << "7. Undo" << undoLabel(contacts, false) << "\n"
+             << INDENT << "8. Redo" << undoLabel(contacts, true) << "\n"
+             << INDENT << "0. Back\n";
+        cout << INDENT << "Choose: ";
+        int ch; cin >> ch;
+        if (ch == 1) addContact();
+        else if (ch == 2) viewContacts();
+        else if (ch == 3) deleteSingleContact();
+        else if (ch == 4) deleteAllContacts();
+        else if (ch == 5) findContact();
+        else if (ch == 6) contactsBetween();
+        else if (ch == 7) undoLast(contacts, false, rewriteContactsFile);
+        else if (ch == 8) undoLast(contacts, true, rewriteContactsFile);
+        else if (ch == 0) break;
+        else cout << INDENT << RED << "Invalid." << RESET << "\n";
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "common.h"
+
+// -------------------- UI Helpers ------------------------
+void showTitle();
+// -------------------- Notes UI --------------------------
+void addNote() ;
+void viewNotes();
+void formatNoteBlock(string& out, size_t i);
+void searchNotes();
+void notesBetween();
+void deleteSingleNote();
+void deleteOldNotes();
+void deleteAllNotes() ;
+// -------------------- Tasks UI --------------------------
+void addTask() ;
+void viewTasks();
+void formatTaskRow(string& out, size_t i);
+void toggleOrDeleteTask();
+void tasksBetween();
+void deleteCompletedTasks();
+void setTaskSchedule();
+void nextUpTasks();
+// Overdue tasks, shown once after login
+void showReminders();
+//-------------------- Contacts UI -----------------------
+void addContact();
+void viewContacts();
+void formatContactHeader(string& out);
+void formatContactRow(string& out, size_t i);
+void findContact();
+void contactsBetween();
+void deleteSingleContact();
+void deleteAllContacts();
+// ---------------------- Menus ---------------------------
+void notesMenu();
+void tasksMenu();
+void contactsMenu();
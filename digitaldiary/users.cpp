@@ -0,0 +1,332 @@
+#include "users.h"
+#include "crypto.h"
+#include "files.h"
+#include "terminal.h"
+
+// users.idx layout: magic, version, USERS_FILE size covered, user
+// count, slot count (a power of two), then slots of (name hash,
+// line offset + 1); an offset of 0 marks an empty slot
+const char USERS_INDEX_MAGIC[4] = {'D', 'D', 'U', 'X'};
+const uint16_t USERS_INDEX_VERSION = 1;
+const size_t USERS_INDEX_HEADER = 40;
+const uint64_t USERS_INDEX_MIN_SLOTS = 64;
+
+static uint64_t nameHash(string_view s) {
+    uint64_t h = 1469598103934665603ull; // FNV-1a
+    for (char c : s) { h ^= (unsigned char)c; h *= 1099511628211ull; }
+    return h;
+}
+
+static bool seekTo(FILE* f, uint64_t off) {
+#ifdef _WIN32
+    return _fseeki64(f, (__int64)off, SEEK_SET) == 0;
+#else
+    return fseeko(f, (off_t)off, SEEK_SET) == 0;
+#endif
+}
+
+static bool readAt(FILE* f, uint64_t off, void* p, size_t n) {
+    if (!seekTo(f, off) || fread(p, 1, n, f) != n) return false;
+    STAT_IO(bytesRead, n);
+    return true;
+}
+
+static bool writeAt(FILE* f, uint64_t off, const void* p, size_t n) {
+    if (!seekTo(f, off) || fwrite(p, 1, n, f) != n) return false;
+    STAT_IO(bytesWritten, n);
+    return true;
+}
+
+// split "name credential" (the format older versions read with >>)
+static bool parseUserLine(string_view line, string_view& name, string_view& cred) {
+    auto token = [&](string_view& out) {
+        size_t a = line.find_first_not_of(" \t\r");
+        if (a == string_view::npos) return false;
+        size_t b = line.find_first_of(" \t\r", a);
+        if (b == string_view::npos) b = line.size();
+        out = line.substr(a, b - a);
+        line.remove_prefix(b);
+        return true;
+    };
+    return token(name) && token(cred);
+}
+
+// read the USERS_FILE line starting at off
+static bool readUserLine(FILE* f, uint64_t off, string& name, string& cred) {
+    if (!seekTo(f, off)) return false;
+    string line;
+    char buf[256];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        const char* nl = (const char*)memchr(buf, '\n', n);
+        line.append(buf, nl ? size_t(nl - buf) : n);
+        if (nl) break;
+    }
+    if (ferror(f)) return false;
+    STAT_IO(bytesRead, line.size());
+    string_view nv, cv;
+    if (!parseUserLine(line, nv, cv)) return false;
+    name.assign(nv);
+    cred.assign(cv);
+    return true;
+}
+
+bool UserRegistry::rebuild() {
+    MappedFile img;
+    string_view v;
+    if (img.open(textPath)) v = img.view();
+    unordered_map<string_view, uint64_t> latest; // name -> offset of its last line
+    for (size_t pos = 0; pos < v.size();) {
+        size_t end = v.find('\n', pos);
+        if (end == string_view::npos) end = v.size();
+        string_view name, cred;
+        if (parseUserLine(v.substr(pos, end - pos), name, cred)) latest[name] = pos;
+        pos = end + 1;
+    }
+    uint64_t slots = USERS_INDEX_MIN_SLOTS;
+    while (slots < 4 * (uint64_t)latest.size()) slots <<= 1;
+    string out;
+    out.reserve(USERS_INDEX_HEADER + slots * 16);
+    out.append(USERS_INDEX_MAGIC, 4);
+    putRaw<uint16_t>(out, USERS_INDEX_VERSION);
+    putRaw<uint16_t>(out, 0);
+    putRaw<uint64_t>(out, v.size());
+    putRaw<uint64_t>(out, latest.size());
+    putRaw<uint64_t>(out, slots);
+    putRaw<uint64_t>(out, 0);
+    out.resize(USERS_INDEX_HEADER + slots * 16, '\0');
+    for (const auto& p : latest) {
+        uint64_t h = nameHash(p.first), i = h & (slots - 1);
+        while (getRaw<uint64_t>(out.data() + USERS_INDEX_HEADER + i * 16 + 8)) i = (i + 1) & (slots - 1);
+        uint64_t slot[2] = {h, p.second + 1};
+        memcpy(&out[USERS_INDEX_HEADER + i * 16], slot, 16);
+    }
+    return writeFileAtomic(indexPath, out);
+}
+
+// open the index, rebuilding it first if it does not cover USERS_FILE
+FILE* UserRegistry::openIndex(const char* mode, uint64_t& slots, uint64_t& count) {
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        if (attempt && !rebuild()) return nullptr;
+        FILE* f = fopen(indexPath.c_str(), mode);
+        if (!f) continue;
+        STAT_IO(fileOpens, 1);
+        char head[USERS_INDEX_HEADER];
+        if (readAt(f, 0, head, sizeof(head)) && memcmp(head, USERS_INDEX_MAGIC, 4) == 0
+            && getRaw<uint16_t>(head + 4) == USERS_INDEX_VERSION
+            && derivedFileCurrent(textPath, indexPath, getRaw<uint64_t>(head + 8))) {
+            count = getRaw<uint64_t>(head + 16);
+            slots = getRaw<uint64_t>(head + 24);
+            if (slots && (slots & (slots - 1)) == 0) return f;
+        }
+        fclose(f);
+    }
+    return nullptr;
+}
+
+// find name's slot; at is its slot, or the empty slot it would take.
+// A slot whose line cannot be read is an Error: it may be name's.
+UserRegistry::Lookup UserRegistry::probe(FILE* idx, FILE* text, const string& name, uint64_t slots,
+                                         string& credential, uint64_t& at) {
+    uint64_t h = nameHash(name);
+    string lineName;
+    for (uint64_t n = 0, i = h & (slots - 1); n < slots; ++n, i = (i + 1) & (slots - 1)) {
+        uint64_t slot[2];
+        at = i;
+        if (!readAt(idx, USERS_INDEX_HEADER + i * 16, slot, 16)) return Lookup::Error;
+        if (slot[1] == 0) return Lookup::Missing;
+        if (slot[0] != h) continue;
+        if (!text || !readUserLine(text, slot[1] - 1, lineName, credential)) return Lookup::Error;
+        if (lineName == name) return Lookup::Found;
+    }
+    at = slots; // full; add() never lets this happen
+    return Lookup::Missing;
+}
+
+UserRegistry::Lookup UserRegistry::find(const string& name, string& credential) {
+    STAT_TIME(STAT_USER_LOOKUP);
+    uint64_t slots, count, at;
+    FILE* idx = openIndex("rb", slots, count);
+    if (!idx) return Lookup::Error;
+    FILE* text = fopen(textPath.c_str(), "rb");
+    if (text) STAT_IO(fileOpens, 1);
+    Lookup found = text || (errno == ENOENT && count == 0) ? probe(idx, text, name, slots, credential, at) : Lookup::Error;
+    if (text) fclose(text);
+    fclose(idx);
+    return found;
+}
+
+bool UserRegistry::add(const string& name, const string& credential, bool onlyNew) {
+    uint64_t slots = 0, count = 0;
+    FILE* idx = openIndex("r+b", slots, count);
+    if (!idx) return false;
+    FILE* text = fopen(textPath.c_str(), "a+b");
+    if (!text) { fclose(idx); return false; }
+    STAT_IO(fileOpens, 1);
+    string old;
+    uint64_t at;
+    Lookup before = probe(idx, text, name, slots, old, at);
+    if (before == Lookup::Error || (onlyNew && before == Lookup::Found)) {
+        fclose(text);
+        fclose(idx);
+        return false;
+    }
+    // append the line; start a new line if the file does not end in one
+    int64_t size = max<int64_t>(fileSize(textPath), 0);
+    char last = '\n';
+    if (size > 0) readAt(text, (uint64_t)size - 1, &last, 1);
+    string line = (last == '\n' ? "" : "\n") + name + " " + credential + "\n";
+    uint64_t offset = (uint64_t)size + (last == '\n' ? 0 : 1);
+    bool ok = fwrite(line.data(), 1, line.size(), text) == line.size();
+    ok = syncFile(text) && ok;
+    fclose(text);
+    STAT_IO(bytesWritten, line.size());
+    if (!ok) {
+        // take back a partial line, it would read as a wrong credential
+        error_code ec;
+        filesystem::resize_file(textPath, (uintmax_t)size, ec);
+        fclose(idx);
+        return false;
+    }
+    if (2 * (count + 1) > slots) {
+        // grow the index from the file
+        fclose(idx);
+        rebuild();
+        return true;
+    }
+    // slot first, then the header: a crash in between leaves a header
+    // that no longer matches USERS_FILE, so the index is rebuilt
+    uint64_t slot[2] = {nameHash(name), offset + 1};
+    uint64_t head[2] = {(uint64_t)size + line.size(), count + (before == Lookup::Found ? 0 : 1)};
+    ok = at < slots && writeAt(idx, USERS_INDEX_HEADER + at * 16, slot, 16) && syncFile(idx)
+      && writeAt(idx, 8, head, 16);
+    ok = syncClose(idx) && ok;
+    if (!ok) rebuild();
+    return true;
+}
+
+bool UserRegistry::verify(const string& name, const string& credential, const string& key) {
+    if (!checkKey(credential, key)) return false;
+    uint32_t iterations = 0;
+    string salt, hash;
+    if ((!parseCredential(credential, iterations, salt, hash) || iterations != keyIterations)
+        && !add(name, hashKey(key, keyIterations)))
+        cerr << YELLOW << "Could not store the rehashed key for " << name << "; the old one still works."
+             << RESET << "\n";
+    return true;
+}
+
+bool authenticate(const string& name, const string& keyFile) {
+    UserRegistry users(USERS_FILE, USERS_INDEX);
+    string credential, key;
+    UserRegistry::Lookup found = users.find(name, credential);
+    if (found != UserRegistry::Lookup::Found) {
+        cerr << (found == UserRegistry::Lookup::Error ? "Cannot read the user list for " : "Unknown user ") << name << "\n";
+        return false;
+    }
+    const char* env = getenv("DIARY_KEY");
+    if (!keyFile.empty()) {
+        ifstream f(keyFile, ios::binary);
+        if (!f || !getline(f, key)) {
+            cerr << "Cannot read key file " << keyFile << "\n";
+            return false;
+        }
+        STAT_IO(fileOpens, 1);
+        if (!key.empty() && key.back() == '\r') key.pop_back();
+    } else if (env) {
+        key = env;
+    } else if (!readSecret(("Secret key for " + name + ": ").c_str(), key)) {
+        cerr << "No key for " << name << ": use --key-file, set DIARY_KEY or run from a terminal\n";
+        return false;
+    }
+    if (!users.verify(name, credential, key)) {
+        cerr << "Incorrect key for " << name << "\n";
+        return false;
+    }
+    return true;
+}
+
+// -------------------- User Shards -----------------------
+// Directory name for a user. Anything but a-z, 0-9, '_' and '-' is
+// written as %XX, so names cannot escape DATA_DIR and "Bob" / "bob"
+// stay distinct on case-insensitive file systems.
+static string shardDirName(const string& name) {
+    static const char* hex = "0123456789ABCDEF";
+    string out;
+    for (unsigned char c : name) {
+        if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_' || c == '-') out += (char)c;
+        else { out += '%'; out += hex[c >> 4]; out += hex[c & 15]; }
+    }
+    return out;
+}
+
+// Point the data file paths at a user's shard, creating it if needed
+void openUserShard(const string& name) {
+    openShardDir(DATA_DIR + "/" + shardDirName(name) + "/");
+}
+
+// Point the data file paths at dir (ending in '/'), creating it if needed
+void openShardDir(const string& dir) {
+    error_code ec;
+    filesystem::create_directories(dir, ec);
+    NOTES_FILE = dir + "notes.txt";
+    TASKS_FILE = dir + "tasks.txt";
+    CONTACTS_FILE = dir + "contacts.txt";
+    NOTES_SNAPSHOT = dir + "notes.bin";
+    TASKS_SNAPSHOT = dir + "tasks.bin";
+    CONTACTS_SNAPSHOT = dir + "contacts.bin";
+    NOTES_INDEX = dir + "notes.idx";
+    NOTES_UNDO = dir + "notes.undo";
+    TASKS_UNDO = dir + "tasks.undo";
+    CONTACTS_UNDO = dir + "contacts.undo";
+    SERVER_SOCKET = dir + "diary.sock";
+    SHARD_LOCK = dir + ".lock";
+}
+
+// Any data file in the current shard. A name that is not registered
+// but has data lost its line in USERS_FILE: its diary is never reset.
+bool shardInUse() {
+    for (const string* p : {&NOTES_FILE, &TASKS_FILE, &CONTACTS_FILE, &NOTES_SNAPSHOT,
+                            &TASKS_SNAPSHOT, &CONTACTS_SNAPSHOT, &NOTES_INDEX,
+                            &NOTES_UNDO, &TASKS_UNDO, &CONTACTS_UNDO})
+        if (fileSize(*p) >= 0) return true;
+    return false;
+}
+
+// The lock is held until the process exits. A daemon compacts and
+// rewrites the logs from its own memory, so a batch run, converter or
+// menu session writing beside it would be overwritten.
+bool lockShard(bool exclusive) {
+#ifdef _WIN32
+    (void)exclusive;
+    return true;
+#else
+    static int fd = -1;
+    if (fd < 0) fd = open(SHARD_LOCK.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) return false;
+    int r;
+    while ((r = flock(fd, (exclusive ? LOCK_EX : LOCK_SH) | LOCK_NB)) != 0 && errno == EINTR) {}
+    return r == 0;
+#endif
+}
+
+// Before shards, every user shared notes.txt/tasks.txt/contacts.txt in
+// the working directory. Offer them to the first user who logs in with
+// an empty shard; moving them means nobody else can claim them later.
+void offerLegacyImport() {
+    const string legacy[3] = {"notes.txt", "tasks.txt", "contacts.txt"};
+    const string* target[3] = {&NOTES_FILE, &TASKS_FILE, &CONTACTS_FILE};
+    bool found = false;
+    for (int i = 0; i < 3; ++i) {
+        if (fileSize(*target[i]) >= 0) return; // shard already in use
+        if (fileSize(legacy[i]) >= 0) found = true;
+    }
+    if (!found) return;
+    cout << YELLOW << "Found diary files from an older version (shared by all users).\n"
+         << "Move them into your diary? (y/N): " << RESET;
+    char ch; cin >> ch;
+    if (ch != 'y' && ch != 'Y') return;
+    for (int i = 0; i < 3; ++i)
+        if (fileSize(legacy[i]) >= 0) replaceFile(legacy[i], *target[i]);
+    cout << GREEN << "Imported." << RESET << "\n";
+}
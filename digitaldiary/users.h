@@ -0,0 +1,54 @@
+#pragma once
+
+#include "common.h"
+
+// USERS_FILE is append-only: one "name credential" line per
+// registration or key upgrade, the last line for a name wins.
+// USERS_INDEX is an open-addressing table of (name hash, line offset)
+// slots, so a login reads a few slots and one line instead of the
+// whole file. The index records the size of USERS_FILE it covers and
+// is rebuilt from the file when that no longer matches.
+class UserRegistry {
+public:
+    // a lookup that could not read the registry is an Error, never
+    // Missing: treating it as a new name would register over the user
+    enum class Lookup { Found, Missing, Error };
+    UserRegistry(string textPath, string indexPath) : textPath(move(textPath)), indexPath(move(indexPath)) {}
+    // Look up a user's stored credential
+    Lookup find(const string& name, string& credential);
+    // Append a user, or a new credential for one, and index it. Nothing
+    // is appended unless the name can be looked up first, or if onlyNew
+    // and it is already there. True once the line is safely in
+    // USERS_FILE; an index left behind is rebuilt on the next lookup.
+    bool add(const string& name, const string& credential, bool onlyNew = false);
+    // Check a login key; on success plain text keys and keys hashed
+    // with another work factor are rehashed with keyIterations (a
+    // failed rehash is reported, the old credential keeps working)
+    bool verify(const string& name, const string& credential, const string& key);
+    // Rewrite the index from USERS_FILE
+    bool rebuild();
+private:
+    string textPath, indexPath;
+    FILE* openIndex(const char* mode, uint64_t& slots, uint64_t& count);
+    Lookup probe(FILE* idx, FILE* text, const string& name, uint64_t slots, string& credential, uint64_t& at);
+};
+
+// Check name's key for a run without the login prompt (--batch,
+// --serve, --connect). The key is the first line of keyFile if one is
+// given, else DIARY_KEY, else typed at a no-echo prompt on the
+// terminal. Says why on stderr; false unless the key matches.
+bool authenticate(const string& name, const string& keyFile);
+
+// -------------------- User Shards -----------------------
+// Point the data file paths at a user's shard, creating it if needed
+void openUserShard(const string& name);
+void openShardDir(const string& dir);
+// true if the current shard holds any data files
+bool shardInUse();
+// Lock the current shard for this process: exclusive for a daemon,
+// which owns the files while it runs, shared for everyone else who
+// opens them. False if it is held the other way (no-op on Windows,
+// which has no daemon).
+bool lockShard(bool exclusive);
+// Offer to move pre-shard notes.txt/tasks.txt/contacts.txt into the shard
+void offerLegacyImport();